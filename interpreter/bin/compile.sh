@@ -1,6 +1,6 @@
 #!/bin/bash
 
-SRC="../src/lexer.cpp ../src/stdlib.cpp ../src/parser.cpp ../src/commons.cpp ../src/interpreter.cpp ../src/roscript.cpp"
+SRC="../src/lexer.cpp ../src/stdlib.cpp ../src/parser.cpp ../src/commons.cpp ../src/memory.cpp ../src/trace.cpp ../src/document.cpp ../src/lsp.cpp ../src/checker.cpp ../src/interpreter.cpp ../src/server.cpp ../src/batch.cpp ../src/bench.cpp ../src/roscript.cpp"
 OUT="ros"
 OBJDIR="./obj"
 WARNFILE="warnings.log"
@@ -16,7 +16,7 @@ for srcfile in $SRC; do
     echo "Compiling $srcfile ..."
 
     # Compile without forcing colors for warnings
-    g++ -std=c++17 -Wall -Wextra -g -c "$srcfile" -o "$objfile" 2> tmp_stderr.log
+    g++ -std=c++17 -Wall -Wextra -g -pthread -c "$srcfile" -o "$objfile" 2> tmp_stderr.log
 
     # Strip colors
     sed -r "s/\x1B\[[0-9;]*[mK]//g" tmp_stderr.log > tmp_stderr_nocolor.log
@@ -37,7 +37,7 @@ done
 echo "Linking..."
 
 # Link all object files, redirect stderr similarly
-g++ -std=c++17 -Wall -Wextra -fdiagnostics-color=always -g $OBJDIR/*.o -o $OUT 2> tmp_stderr.log
+g++ -std=c++17 -Wall -Wextra -fdiagnostics-color=always -g -pthread $OBJDIR/*.o -o $OUT 2> tmp_stderr.log
 
 if [ -s tmp_stderr.log ]; then
     echo "Linker output:"
@@ -49,6 +49,20 @@ else
     rm tmp_stderr.log
 fi
 
+# The microbenchmarks link the same objects, minus the ros entry point
+echo "Building microbench..."
+g++ -std=c++17 -Wall -Wextra -g -pthread ../src/microbench.cpp $(ls $OBJDIR/*.o | grep -v roscript.o) -o microbench 2> tmp_stderr.log
+
+if grep -q "error" tmp_stderr.log; then
+    grep --color=always "error" tmp_stderr.log >&2
+    echo "Building microbench failed."
+    rm tmp_stderr.log
+    exit 1
+else
+    sed -r "s/\x1B\[[0-9;]*[mK]//g" tmp_stderr.log >> $WARNFILE
+    rm tmp_stderr.log
+fi
+
 # Copy executable for IDE
 if [ -f "$OUT" ]; then
     cp "$OUT" ../../roscript-ide
@@ -0,0 +1,239 @@
+/**
+ * @file batch.cpp
+ * @brief Batch runner implementation for the Roscript interpreter.
+ * This file contains `ros --batch`: script discovery, the per script job run on the work-stealing pool, and the summary report.
+ * @see batch.h
+ *
+ * @author Rares-Cosma & Vlad-Oprea
+ * @date 2026-10-18
+ */
+#include "batch.h"
+#include "interpreter.h"
+#include "thread_pool.h"
+#include "checker.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <iomanip>
+
+using namespace std;
+using namespace chrono;
+namespace fs = std::filesystem;
+
+/**
+ * @struct BatchResult
+ * @brief The outcome of one script of the batch.
+ */
+struct BatchResult {
+	string status; // PASSED, FAILED, TIMEOUT or ERROR
+	double seconds = 0;
+	string output;
+	string error;
+};
+
+static vector<string> collect_scripts(const string& target) {
+	/**
+	 * @brief Builds the sorted list of scripts named by the batch target.
+	 */
+	vector<string> scripts;
+	if (fs::is_directory(target)) {
+		for (const auto& entry : fs::recursive_directory_iterator(target)) {
+			if (entry.is_regular_file() && entry.path().extension() == ".ros") {
+				scripts.push_back(entry.path().string());
+			}
+		}
+		sort(scripts.begin(), scripts.end());
+	} else if (fs::path(target).extension() == ".ros") {
+		scripts.push_back(target);
+	} else {
+		ifstream list(target);
+		string line;
+		while (getline(list, line)) {
+			if (!line.empty() && line.back() == '\r') line.pop_back();
+			if (!line.empty()) scripts.push_back(line);
+		}
+	}
+	return scripts;
+}
+
+static string read_file(const fs::path& path) {
+	ifstream file(path, ios::binary);
+	stringstream content;
+	content << file.rdbuf();
+	return content.str();
+}
+
+static string trim(const string& s) {
+	size_t begin = s.find_first_not_of(" \t\r\n");
+	if (begin == string::npos) return "";
+	size_t end = s.find_last_not_of(" \t\r\n");
+	return s.substr(begin, end - begin + 1);
+}
+
+static BatchResult run_script(const string& script, const Limits& limits) {
+	/**
+	 * @brief Runs one script in its own Interpreter with captured streams.
+	 */
+	BatchResult result;
+	fs::path input_path = fs::path(script).replace_extension(".in");
+	fs::path expected_path = fs::path(script).replace_extension(".out");
+
+	istringstream in(fs::exists(input_path) ? read_file(input_path) : "");
+	ostringstream out, err;
+
+	auto start = steady_clock::now();
+	try {
+		Interpreter interpreter(out, in, err);
+		interpreter.limits = limits;
+		interpreter.ctx.threads = 1; // the batch already keeps every core busy with other scripts
+		if (interpreter.load_file(script)) {
+			interpreter.run(false, false, false);
+		}
+		result.status = "PASSED";
+	} catch (const exception& e) {
+		err << "Runtime Error: " << e.what() << "\n";
+		result.status = string(e.what()) == "Time limit exceeded" ? "TIMEOUT" : "ERROR";
+	}
+	result.seconds = duration<double>(steady_clock::now() - start).count();
+	result.output = out.str();
+	result.error = err.str();
+
+	if (result.status == "PASSED") {
+		if (!result.error.empty()) {
+			result.status = "FAILED";
+		} else if (fs::exists(expected_path) && trim(read_file(expected_path)) != trim(result.output)) {
+			result.status = "FAILED";
+			result.error = "Output differs from " + expected_path.string();
+		}
+	}
+	return result;
+}
+
+int run_batch(const string& target, const BatchOptions& options) {
+	vector<string> scripts = collect_scripts(target);
+	vector<BatchResult> results(scripts.size());
+
+	cout << "Running " << scripts.size() << " ROScript script(s) on " << options.threads << " thread(s)...\n\n";
+
+	auto start = steady_clock::now();
+	WorkStealingPool pool(options.threads);
+	pool.run(scripts.size(), [&](size_t i) {
+		results[i] = run_script(scripts[i], options.limits);
+	});
+	double wall = duration<double>(steady_clock::now() - start).count();
+
+	size_t passed = 0;
+	double script_time = 0;
+	for (size_t i = 0; i < scripts.size(); i++) {
+		const BatchResult& r = results[i];
+		script_time += r.seconds;
+		cout << (r.status == "PASSED" ? "✔ " : "✖ ") << r.status << " - " << scripts[i]
+		     << " [" << fixed << setprecision(4) << r.seconds << "s]\n";
+		if (r.status == "PASSED") {
+			passed++;
+			continue;
+		}
+		if (!r.error.empty()) cout << "  Error: " << trim(r.error) << "\n";
+		if (!r.output.empty()) cout << "  Output:\n" << trim(r.output) << "\n";
+	}
+
+	cout << "\nSummary: " << passed << "/" << scripts.size() << " script(s) passed.\n";
+	cout << "Wall time: " << fixed << setprecision(4) << wall << "s, script time: " << script_time << "s, throughput: "
+	     << setprecision(1) << (wall > 0 ? scripts.size() / wall : 0) << " scripts/s\n";
+	return passed == scripts.size() ? 0 : 1;
+}
+
+static string json_string(const string& s) {
+	string result = "\"";
+	for (unsigned char c : s) {
+		if (c == '"' || c == '\\') result += string("\\") + static_cast<char>(c);
+		else if (c == '\n') result += "\\n";
+		else if (c == '\t') result += "\\t";
+		else if (c < 0x20) {
+			char escaped[8];
+			snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+			result += escaped;
+		} else result += static_cast<char>(c);
+	}
+	return result + "\"";
+}
+
+/**
+ * @struct Diagnosis
+ * @brief The problems found in one script by --diagnostics or --check.
+ */
+struct Diagnosis {
+	bool found = true;
+	vector<SyntaxError> problems;
+	int errors = 0, warnings = 0;
+};
+
+static Diagnosis diagnose_script(const string& script, bool check) {
+	/**
+	 * @brief Lexes and parses one script without running it and, for --check, runs the static checker on it if it parsed.
+	 */
+	Diagnosis result;
+	ifstream file(script);
+	if (!file) {
+		result.found = false;
+		return result;
+	}
+
+	vector<Span> spans;
+	auto tokens = lexer(file, &spans);
+	ostream quiet(nullptr);
+	Parser parser;
+	parser.err = &quiet;
+	parser.parse(tokens.first, tokens.second, spans);
+	result.problems = parser.errors;
+	bool parsed = none_of(parser.errors.begin(), parser.errors.end(), [](const SyntaxError& e) { return !e.warning; });
+	if (check && parsed) { // the AST of a script with syntax errors is missing statements, the checker would report their names
+		vector<SyntaxError> found = check_program(parser);
+		result.problems.insert(result.problems.end(), found.begin(), found.end());
+		stable_sort(result.problems.begin(), result.problems.end(), [](const SyntaxError& a, const SyntaxError& b) { return a.line_nb < b.line_nb; });
+	}
+	for (const SyntaxError& e : result.problems) (e.warning ? result.warnings : result.errors)++;
+	return result;
+}
+
+static string json_diagnosis(const string& script, const Diagnosis& d) {
+	string json = "{\"file\":" + json_string(script);
+	if (!d.found) return json + ",\"error\":\"File not found\"}";
+	string diagnostics;
+	for (const SyntaxError& e : d.problems) {
+		if (!diagnostics.empty()) diagnostics += ",";
+		diagnostics += "{\"line\":" + to_string(e.line_nb) + ",\"column\":" + to_string(e.column + 1) +
+		               ",\"end_column\":" + to_string(max(e.end_column, e.column + 1) + 1) +
+		               ",\"severity\":" + (e.warning ? "\"warning\"" : "\"error\"") + ",\"message\":" + json_string(e.message) + "}";
+	}
+	return json + ",\"errors\":" + to_string(d.errors) + ",\"warnings\":" + to_string(d.warnings) + ",\"diagnostics\":[" + diagnostics + "]}";
+}
+
+static string text_diagnosis(const string& script, const Diagnosis& d) {
+	if (!d.found) return script + ": error: File not found\n";
+	string text;
+	for (const SyntaxError& e : d.problems) {
+		text += script + ":" + to_string(e.line_nb) + ":" + (e.column ? to_string(e.column + 1) + ":" : "") +
+		        (e.warning ? " warning: " : " error: ") + e.message + "\n";
+	}
+	return text;
+}
+
+int run_diagnostics(const string& target, const BatchOptions& options, bool check, bool json) {
+	vector<string> scripts = collect_scripts(target);
+	vector<Diagnosis> results(scripts.size());
+
+	WorkStealingPool pool(options.threads);
+	pool.run(scripts.size(), [&](size_t i) { results[i] = diagnose_script(scripts[i], check); });
+
+	int errors = 0, warnings = 0;
+	for (size_t i = 0; i < scripts.size(); i++) {
+		cout << (json ? json_diagnosis(scripts[i], results[i]) + "\n" : text_diagnosis(scripts[i], results[i]));
+		errors += results[i].errors + !results[i].found;
+		warnings += results[i].warnings;
+	}
+	if (!json) cout << "Checked " << scripts.size() << " script(s): " << errors << " error(s), " << warnings << " warning(s).\n";
+	cout.flush();
+	return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,47 @@
+/**
+ * @file batch.h
+ * @brief Header file for the batch runner of the Roscript interpreter.
+ * The batch runner executes many scripts in parallel inside one process and compares their output with the expected one.
+ * @author Rares-Cosma & Vlad-Oprea
+ * @date 2026-10-18
+ */
+
+#pragma once
+#include <string>
+#include <thread>
+#include "variables.h"
+
+using namespace std;
+
+/**
+ * @struct BatchOptions
+ * @brief Settings of a batch run, filled from the command line.
+ */
+struct BatchOptions {
+	unsigned threads = thread::hardware_concurrency(); // -j
+	Limits limits = {0, 0, 5000}; // -t (per script wall-clock limit), --max-ops, --max-mem
+};
+
+/**
+ * @brief Runs every script of a directory (recursively), of a list file, or a single .ros file.
+ * @param target A directory, a text file with one script path per line, or a .ros file.
+ * @param options The number of worker threads and the per script timeout.
+ * @return 0 if every script passed, 1 otherwise.
+ * @note For a script `x.ros`, the file `x.in` (if present) is its standard input and `x.out` (if present) its expected output.
+ * A script passes when it raises no error and, if `x.out` exists, prints the same text (ignoring surrounding whitespace).
+ */
+int run_batch(const string& target, const BatchOptions& options);
+
+/**
+ * @brief Checks every script named by the target without running them: their syntax and, for --check, the static checks.
+ * @param target A directory, a list file or a .ros file, as for run_batch.
+ * @param options Only the number of worker threads is used.
+ * @param check Whether to run the static checker (checker.h) on the scripts without syntax errors.
+ * @param json Whether to print JSON lines (--diagnostics, --check --json) or `file:line: error: message` lines and a summary.
+ * @return 0 if no script has an error (warnings allowed), 1 otherwise.
+ * @note One JSON object per line and per script, in the order of the scripts:
+ * `{"file":..., "errors":N, "warnings":N, "diagnostics":[{"line":L, "column":C, "end_column":E, "severity":"error"|"warning", "message":...}]}`.
+ * Lines and columns are 1-based, end_column excluded. The parse goes on after an error, so every broken statement is reported.
+ * The checker's problems have no column: they are reported at column 1 (and without one in the text output).
+ */
+int run_diagnostics(const string& target, const BatchOptions& options, bool check = false, bool json = true);
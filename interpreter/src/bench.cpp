@@ -0,0 +1,241 @@
+/**
+ * @file bench.cpp
+ * @brief Benchmark suite implementation for the Roscript interpreter.
+ * This file contains `ros --bench`: the generated lexer and parser workloads, the timed script runs, the statistics,
+ * the JSON report and the baseline comparison.
+ * @see bench.h
+ *
+ * @author Rares-Cosma & Vlad-Oprea
+ * @date 2026-10-18
+ */
+#include "bench.h"
+#include "interpreter.h"
+#include "lexer.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <cmath>
+
+using namespace std;
+using namespace chrono;
+namespace fs = std::filesystem;
+
+/**
+ * @struct BenchResult
+ * @brief The timings of one benchmark.
+ */
+struct BenchResult {
+	string name;
+	vector<double> ms; // one entry per timed run, sorted
+	double median = 0, p95 = 0, min = 0, mean = 0;
+	double work = 0; // units of work per run (bytes, tokens), 0 if the benchmark has no throughput
+	string unit; // unit of work / second
+	string error;
+};
+
+static string read_file(const fs::path& path) {
+	ifstream file(path, ios::binary);
+	stringstream content;
+	content << file.rdbuf();
+	return content.str();
+}
+
+string generate_script(int groups) {
+	string source;
+	for (int i = 0; i < groups; i++) {
+		string v = "v" + to_string(i);
+		source += "var " + v + " = " + to_string(i) + " * 3 + 7;\n";
+		source += v + " = " + v + " + 1.5;\n";
+		source += "daca (" + v + " > 10) {\n    " + v + " = " + v + " - 1;\n} altfel {\n    " + v + " = " + v + " + 2;\n}\n";
+		source += "cat timp (" + v + " < 0) {\n    " + v + " = " + v + " + 1;\n}\n";
+		source += "afiseaza(\"valoare \", " + v + ", \"\\n\");\n";
+	}
+	return source;
+}
+
+static void summarize(BenchResult& result) {
+	/**
+	 * @brief Sorts the timings and computes median, p95 (nearest rank), min and mean.
+	 */
+	vector<double>& ms = result.ms;
+	sort(ms.begin(), ms.end());
+	size_t n = ms.size();
+	result.median = n % 2 ? ms[n / 2] : (ms[n / 2 - 1] + ms[n / 2]) / 2;
+	result.p95 = ms[static_cast<size_t>(ceil(0.95 * n)) - 1];
+	result.min = ms.front();
+	for (double t : ms) result.mean += t / n;
+}
+
+static BenchResult measure(const string& name, const BenchOptions& options, const function<double()>& once) {
+	/**
+	 * @brief Runs a benchmark `warmup` times untimed, then `repeats` times timed.
+	 * @param once Runs the workload once and returns the measured milliseconds, throws on failure.
+	 */
+	BenchResult result;
+	result.name = name;
+	try {
+		for (int i = 0; i < options.warmup; i++) once();
+		for (int i = 0; i < options.repeats; i++) result.ms.push_back(once());
+		summarize(result);
+	} catch (const exception& e) {
+		result.error = e.what();
+	}
+	return result;
+}
+
+static double elapsed_ms(steady_clock::time_point start) {
+	return duration<double, milli>(steady_clock::now() - start).count();
+}
+
+static BenchResult bench_lexer(const BenchOptions& options, const string& source) {
+	BenchResult result = measure("lexer", options, [&]() {
+		istringstream stream(source);
+		auto start = steady_clock::now();
+		lexer(stream);
+		return elapsed_ms(start);
+	});
+	result.work = source.size() / 1e6;
+	result.unit = "MB/s";
+	return result;
+}
+
+static BenchResult bench_parser(const BenchOptions& options, const string& source) {
+	istringstream stream(source);
+	auto tokens = lexer(stream);
+	BenchResult result = measure("parser", options, [&]() {
+		ostringstream errors;
+		Parser parser;
+		parser.err = &errors;
+		auto start = steady_clock::now();
+		parser.parse(tokens.first, tokens.second);
+		double ms = elapsed_ms(start);
+		if (!errors.str().empty()) throw runtime_error(errors.str());
+		return ms;
+	});
+	result.work = tokens.first.size() / 1e3;
+	result.unit = "ktokens/s";
+	return result;
+}
+
+static BenchResult bench_script(const BenchOptions& options, const fs::path& script) {
+	string source = read_file(script);
+	fs::path input_path = fs::path(script).replace_extension(".in");
+	string input = fs::exists(input_path) ? read_file(input_path) : "";
+
+	return measure(script.stem().string(), options, [&]() {
+		istringstream in(input);
+		ostringstream out, err;
+		Interpreter interpreter(out, in, err);
+		interpreter.load_source(source);
+		auto start = steady_clock::now();
+		interpreter.run(false, false, false);
+		double ms = elapsed_ms(start);
+		if (!err.str().empty()) throw runtime_error(err.str());
+		return ms;
+	});
+}
+
+static map<string, double> load_baseline(const string& path) {
+	/**
+	 * @brief Reads the medians of a JSON report written by an earlier run.
+	 * @note Only the format written by write_json is understood: every benchmark object has "name" before "median_ms".
+	 */
+	map<string, double> medians;
+	string json = read_file(path);
+	const string name_key = "\"name\": \"", median_key = "\"median_ms\": ";
+	size_t pos = 0;
+	while ((pos = json.find(name_key, pos)) != string::npos) {
+		pos += name_key.size();
+		size_t end = json.find('"', pos);
+		size_t median = json.find(median_key, end);
+		if (end == string::npos || median == string::npos) break;
+		medians[json.substr(pos, end - pos)] = strtod(json.c_str() + median + median_key.size(), nullptr);
+		pos = median;
+	}
+	return medians;
+}
+
+static void write_json(const string& path, const BenchOptions& options, const vector<BenchResult>& results) {
+	ofstream file(path);
+	file << fixed << setprecision(4);
+	file << "{\n  \"warmup\": " << options.warmup << ",\n  \"repeats\": " << options.repeats << ",\n  \"benchmarks\": [\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		const BenchResult& r = results[i];
+		file << "    {\"name\": \"" << r.name << "\"";
+		if (r.error.empty()) {
+			file << ", \"median_ms\": " << r.median << ", \"p95_ms\": " << r.p95 << ", \"min_ms\": " << r.min << ", \"mean_ms\": " << r.mean;
+			if (r.work > 0) file << ", \"throughput\": " << r.work / (r.median / 1000) << ", \"unit\": \"" << r.unit << "\"";
+		} else {
+			file << ", \"error\": true";
+		}
+		file << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	file << "  ]\n}\n";
+}
+
+int run_bench(const BenchOptions& options) {
+	if (options.repeats < 1) {
+		cout << "Benchmarks need at least one timed run.\n";
+		return 1;
+	}
+
+	vector<fs::path> scripts;
+	if (fs::is_directory(options.dir)) {
+		for (const auto& entry : fs::directory_iterator(options.dir)) {
+			if (entry.is_regular_file() && entry.path().extension() == ".ros") scripts.push_back(entry.path());
+		}
+		sort(scripts.begin(), scripts.end());
+	} else {
+		cout << "Benchmark directory not found: " << options.dir << "\n";
+	}
+
+	cout << "Running " << scripts.size() + 2 << " benchmark(s), " << options.warmup << " warm-up and "
+	     << options.repeats << " timed run(s) each...\n\n";
+
+	vector<BenchResult> results;
+	results.push_back(bench_lexer(options, generate_script(4000)));
+	results.push_back(bench_parser(options, generate_script(4000)));
+	for (const fs::path& script : scripts) {
+		results.push_back(bench_script(options, script));
+	}
+
+	map<string, double> baseline;
+	if (!options.baseline.empty()) baseline = load_baseline(options.baseline);
+
+	int status = 0;
+	cout << left << setw(14) << "Benchmark" << right << setw(12) << "median ms" << setw(12) << "p95 ms" << setw(12) << "min ms"
+	     << setw(20) << "throughput" << (baseline.empty() ? "" : "    vs baseline") << "\n";
+	for (const BenchResult& r : results) {
+		cout << left << setw(14) << r.name << right;
+		if (!r.error.empty()) {
+			cout << "  ERROR: " << r.error << "\n";
+			status = 1;
+			continue;
+		}
+		cout << fixed << setprecision(3) << setw(12) << r.median << setw(12) << r.p95 << setw(12) << r.min;
+		ostringstream throughput;
+		if (r.work > 0) throughput << fixed << setprecision(2) << r.work / (r.median / 1000) << " " << r.unit;
+		cout << setw(20) << throughput.str();
+
+		auto base = baseline.find(r.name);
+		if (base != baseline.end() && base->second > 0) {
+			double change = (r.median - base->second) / base->second * 100;
+			cout << "    " << showpos << setprecision(1) << change << "%" << noshowpos;
+			if (change > options.threshold) {
+				cout << " REGRESSION";
+				status = 1;
+			}
+		}
+		cout << "\n";
+	}
+
+	if (!options.json.empty()) {
+		write_json(options.json, options, results);
+		cout << "\nResults written to " << options.json << "\n";
+	}
+	return status;
+}
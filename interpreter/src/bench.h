@@ -0,0 +1,41 @@
+/**
+ * @file bench.h
+ * @brief Header file for the benchmark suite of the Roscript interpreter.
+ * The suite times the lexer and the parser on generated large scripts and the interpreter on the benchmark scripts,
+ * reports median and p95 over repeated runs, and compares them against a stored baseline.
+ * @author Rares-Cosma & Vlad-Oprea
+ * @date 2026-10-18
+ */
+
+#pragma once
+#include <string>
+
+using namespace std;
+
+/**
+ * @struct BenchOptions
+ * @brief Settings of a benchmark run, filled from the command line.
+ */
+struct BenchOptions {
+	string dir = "unit_tests/simple_benchmarks"; // directory of the benchmark scripts
+	int warmup = 2; // -w, untimed runs before measuring
+	int repeats = 10; // -r, timed runs
+	string json; // -o, where the results are written as JSON
+	string baseline; // -b, results of an earlier run to compare against
+	double threshold = 10; // -x, percent a median may grow before it counts as a regression
+};
+
+/**
+ * @brief Builds a large script mixing every kind of statement, used to measure the lexer and the parser.
+ * @param groups Number of repeated statement groups (each about 12 lines).
+ */
+string generate_script(int groups);
+
+/**
+ * @brief Runs the benchmark suite and prints a report.
+ * @param options The benchmark directory, run counts and the JSON files to write and compare against.
+ * @return 0 on success, 1 if a benchmark failed or regressed past the threshold.
+ * @note For a script `x.ros`, the file `x.in` (if present) is its standard input. Only the run is timed, loading is covered by
+ * the `lexer` and `parser` benchmarks. Output is captured, so printing costs the formatting but no terminal I/O.
+ */
+int run_bench(const BenchOptions& options);
@@ -0,0 +1,440 @@
+/**
+ * @file checker.cpp
+ * @brief Static checker implementation for the Roscript interpreter.
+ * This file contains the name resolution over the AST (the globals, one scope per function and one per nested block, like the
+ * runtime), the type inference on sets of types, and the checks run once the types are known.
+ * @see checker.h
+ *
+ * @author Rares-Cosma & Vlad-Oprea
+ * @date 2026-10-18
+ */
+#include "checker.h"
+#include <unordered_set>
+#include <sstream>
+#include <memory>
+
+/**
+ * @enum TypeSet
+ * @brief Bits of the types a value may have, in the order of the Value alternatives.
+ */
+enum TypeSet : int { T_NONE = 0, T_INT = 1, T_FLOAT = 2, T_STRING = 4, T_BOOL = 8, T_ANY = 15 };
+
+static const char* type_names[] = {"int", "float", "string", "bool"};
+
+static int type_of(const Value& value) {
+	return 1 << value.index();
+}
+
+static int parse_types(const string& names) {
+	/**
+	 * @brief The set of the space separated type names, every type for an empty string.
+	 */
+	if (names.empty()) return T_ANY;
+	int types = T_NONE;
+	istringstream words(names);
+	string word;
+	while (words >> word) {
+		for (int i = 0; i < 4; i++) {
+			if (word == type_names[i]) types |= 1 << i;
+		}
+	}
+	return types;
+}
+
+static string describe(int types) {
+	string result;
+	for (int i = 0; i < 4; i++) {
+		if (types & (1 << i)) result += (result.empty() ? "" : " or ") + string(type_names[i]);
+	}
+	return result;
+}
+
+static int binary_result(const string& op, int left, int right, bool& possible) {
+	/**
+	 * @brief The types `left op right` may produce, found by running BinaryExpr::apply on a sample of each pair of types.
+	 * @param possible Set to whether any pair is supported.
+	 */
+	static const Value samples[] = {Value(1), Value(1.0f), Value(string("a")), Value(true)};
+	int result = T_NONE;
+	possible = false;
+	for (int i = 0; i < 4; i++) {
+		if (!(left & (1 << i))) continue;
+		for (int j = 0; j < 4; j++) {
+			if (!(right & (1 << j))) continue;
+			try {
+				result |= type_of(BinaryExpr::apply(op, samples[i], samples[j]));
+				possible = true;
+			} catch (const exception&) {
+			}
+		}
+	}
+	return result;
+}
+
+static bool accepts_count(const BuiltinSignature& signature, int count) {
+	return count >= signature.min_args && (signature.max_args < 0 || count <= signature.max_args);
+}
+
+static string arguments(int count) {
+	return to_string(count) + (count == 1 ? " argument" : " arguments");
+}
+
+/**
+ * @struct Symbol
+ * @brief One variable of one scope.
+ */
+struct Symbol {
+	enum Kind { VARIABLE, PARAMETER, LOOP };
+
+	string name;
+	int line; // of its first declaration
+	Kind kind;
+	int function; // the function declaring it, numbered from 1, 0 for the top level
+	bool read = false;
+	int types = T_NONE; // every type it may hold, grown until the inference settles
+};
+
+/**
+ * @class Checker
+ * @brief The state of one check_program() call.
+ */
+class Checker {
+	public:
+		explicit Checker(const Parser& parser) : parser(parser) {}
+
+		vector<SyntaxError> run() {
+			collect(parser.AST, globals);
+			scopes = {&globals};
+			block(parser.AST);
+			infer_all();
+
+			unordered_map<const Expr*, int> cache;
+			for (const auto& [expr, line] : operations) check_operation(expr, line, cache);
+			for (const auto& [update, line] : updates) check_update(assignments[update], line, cache);
+			for (const auto& symbol : symbols) {
+				if (symbol->kind == Symbol::VARIABLE && !symbol->read) warn(symbol->line, "Variable '" + symbol->name + "' is never used");
+			}
+			stable_sort(problems.begin(), problems.end(), [](const SyntaxError& a, const SyntaxError& b) { return a.line_nb < b.line_nb; });
+			return problems;
+		}
+
+	private:
+		/**
+		 * @struct Assignment
+		 * @brief A value given to a variable, re-inferred whenever a variable it reads may hold more types.
+		 */
+		struct Assignment {
+			Symbol* target;
+			const Expr* value;
+			char op = 0; // an UpdateStatement's operator: the value given is `target op value`
+		};
+
+		using Scope = unordered_map<string, Symbol*>;
+
+		const Parser& parser;
+		vector<unique_ptr<Symbol>> symbols;
+		Scope globals;
+		vector<Scope*> scopes; // the visible ones, innermost last: the globals, the function's own, the enclosing blocks'
+		int function_id = 0, functions = 0; // the function being walked (0 for the top level), the number of functions walked
+		unordered_set<const Symbol*> declared; // the declarations walked so far
+		unordered_set<string> undeclared; // names already reported in the current scope
+		unordered_map<const Refrence*, Symbol*> references;
+		vector<Assignment> assignments;
+		unordered_map<const Symbol*, vector<size_t>> readers; // the assignments reading each variable
+		vector<pair<const Expr*, int>> operations; // checked once the types are known
+		vector<pair<size_t, int>> updates; // the assignments of the UpdateStatements, checked once the types are known
+		vector<SyntaxError> problems;
+
+		void error(int line, const string& message, Span span = Span(0, 0)) { problems.push_back({line, message, "", span.first, span.second, false}); }
+		void warn(int line, const string& message) { problems.push_back({line, message, "", 0, 0, true}); }
+
+		Symbol* declare(Scope& scope, const string& name, int line, Symbol::Kind kind) {
+			auto it = scope.find(name);
+			if (it != scope.end()) return it->second;
+			symbols.push_back(unique_ptr<Symbol>(new Symbol{name, line, kind, function_id}));
+			return scope[name] = symbols.back().get();
+		}
+
+		void collect(const vector<ASTNode*>& statements, Scope& scope, int parent_line = 0) {
+			/**
+			 * @brief Declares the variables of a scope before walking it, so a use before the declaration is told apart from
+			 * a name declared nowhere. Only the block's own statements declare in it: nested blocks are scopes of their own.
+			 */
+			for (ASTNode* node : statements) {
+				if (!node) continue;
+				int line = node->line ? node->line : parent_line;
+				if (auto decl = dynamic_cast<VariableDeclaration*>(node)) {
+					declare(scope, decl->name, line, Symbol::VARIABLE);
+				} else if (auto loop = dynamic_cast<ForStatement*>(node)) {
+					collect({loop->init_block}, scope, line);
+				} else if (auto loop = dynamic_cast<ForEachStatement*>(node)) {
+					declare(scope, loop->name, line, Symbol::LOOP);
+				}
+			}
+		}
+
+		Symbol* resolve(const string& name, int line, bool read) {
+			/**
+			 * @brief Finds the variable a name refers to, like the runtime: the innermost block first, out to the globals.
+			 */
+			Symbol* symbol = nullptr;
+			for (auto scope = scopes.rbegin(); scope != scopes.rend() && !symbol; ++scope) {
+				auto it = (*scope)->find(name);
+				if (it != (*scope)->end()) symbol = it->second;
+			}
+			if (!symbol) {
+				if (undeclared.insert(name).second) error(line, "Variable '" + name + "' is not declared");
+				return nullptr;
+			}
+			if (read && !declared.count(symbol) && symbol->function == function_id) { // a function may read globals declared after it
+				warn(line, "Variable '" + name + "' is used before it is declared");
+				declared.insert(symbol); // reported once
+			}
+			return symbol;
+		}
+
+		void assign(Symbol* target, const Expr* value, const vector<Symbol*>& reads, char op = 0) {
+			if (!target || !value) return;
+			for (Symbol* read : reads) readers[read].push_back(assignments.size());
+			assignments.push_back({target, value, op});
+		}
+
+		void block(const vector<ASTNode*>& statements, int parent_line = 0) {
+			for (ASTNode* node : statements) {
+				if (node) statement(node, node->line ? node->line : parent_line);
+			}
+		}
+
+		void scoped_block(const vector<ASTNode*>& statements, int line) {
+			/**
+			 * @brief Walks a nested block in a scope of its own: its variables are not visible after it, like at run time.
+			 */
+			Scope scope;
+			collect(statements, scope, line);
+			scopes.push_back(&scope);
+			block(statements, line);
+			scopes.pop_back();
+		}
+
+		void statement(ASTNode* node, int line) {
+			vector<Symbol*> reads;
+			if (auto decl = dynamic_cast<VariableDeclaration*>(node)) {
+				expr(decl->value, line, &reads);
+				Symbol* target = (*scopes.back())[decl->name];
+				declared.insert(target);
+				assign(target, decl->value, reads);
+			} else if (auto assignment = dynamic_cast<AssignStatement*>(node)) {
+				expr(assignment->expr, line, &reads);
+				assign(resolve(assignment->name, line, false), assignment->expr, reads);
+			} else if (auto update = dynamic_cast<UpdateStatement*>(node)) {
+				expr(update->expr, line, &reads);
+				if (Symbol* target = resolve(update->name, line, true)) {
+					target->read = true; // the update reads the old value
+					reads.push_back(target);
+					updates.push_back({assignments.size(), line});
+					assign(target, update->expr, reads, update->op);
+				}
+			} else if (auto input = dynamic_cast<InputStatement*>(node)) {
+				if (Symbol* target = resolve(input->name, line, false)) target->types |= T_STRING;
+			} else if (auto print = dynamic_cast<PrintStatement*>(node)) {
+				expr(print->expr, line);
+			} else if (auto ret = dynamic_cast<ReturnStatement*>(node)) {
+				expr(ret->expr, line);
+			} else if (auto ifs = dynamic_cast<IfStatement*>(node)) {
+				expr(ifs->expr, line);
+				scoped_block(ifs->block, line);
+				for (auto& branch : ifs->elseIfBranches) {
+					expr(branch.first, line);
+					scoped_block(branch.second, line);
+				}
+				scoped_block(ifs->elseBlock, line);
+			} else if (auto sw = dynamic_cast<SwitchStatement*>(node)) {
+				expr(sw->expr, line);
+				for (auto& c : sw->cases) scoped_block(c.second, line);
+				scoped_block(sw->elseBlock, line);
+			} else if (auto loop = dynamic_cast<WhileStatement*>(node)) {
+				expr(loop->expr, line);
+				scoped_block(loop->block, line);
+			} else if (auto loop = dynamic_cast<DoWhileStatement*>(node)) {
+				scoped_block(loop->block, line);
+				expr(loop->expr, line);
+			} else if (auto loop = dynamic_cast<DoUntilStatement*>(node)) {
+				scoped_block(loop->block, line);
+				expr(loop->expr, line);
+			} else if (auto loop = dynamic_cast<ForStatement*>(node)) {
+				if (loop->init_block) statement(loop->init_block, line);
+				expr(loop->expr, line);
+				scoped_block(loop->block, line);
+				if (loop->assign_block) statement(loop->assign_block, line);
+			} else if (auto loop = dynamic_cast<ForEachStatement*>(node)) {
+				for (Expr* e : {loop->sequence, loop->start, loop->end, loop->step}) expr(e, line);
+				Symbol* variable = (*scopes.back())[loop->name];
+				variable->types |= loop->sequence ? T_STRING : T_INT;
+				declared.insert(variable);
+				scoped_block(loop->block, line);
+			} else if (auto func = dynamic_cast<FunctionDefinition*>(node)) {
+				function(func, line);
+			} else if (auto e = dynamic_cast<Expr*>(node)) {
+				expr(e, line);
+			}
+		}
+
+		void function(FunctionDefinition* func, int line) {
+			/**
+			 * @brief Walks a function body in a scope of its own, holding its parameters and the variables it declares.
+			 */
+			int enclosing_id = function_id;
+			function_id = ++functions;
+			Scope scope;
+			for (ASTNode* arg : func->args) {
+				if (auto param = dynamic_cast<VariableDeclaration*>(arg)) {
+					Symbol* symbol = declare(scope, param->name, line, Symbol::PARAMETER);
+					symbol->types = T_ANY; // whatever the callers pass
+					declared.insert(symbol);
+				}
+			}
+			collect(func->block, scope, line);
+
+			vector<Scope*> enclosing = {&globals, &scope}; // a function sees its own variables and the globals, not its caller's
+			swap(scopes, enclosing);
+			unordered_set<string> enclosing_undeclared;
+			swap(undeclared, enclosing_undeclared);
+			block(func->block, line);
+			swap(scopes, enclosing);
+			swap(undeclared, enclosing_undeclared);
+			function_id = enclosing_id;
+		}
+
+		void expr(const Expr* e, int line, vector<Symbol*>* reads = nullptr) {
+			/**
+			 * @brief Resolves the names an expression reads and checks the arity of its calls.
+			 * @param reads If not null, collects the variables read, the ones the expression's type depends on.
+			 */
+			if (!e) return;
+			if (auto ref = dynamic_cast<const Refrence*>(e)) {
+				if (Symbol* symbol = resolve(ref->name, line, true)) {
+					symbol->read = true;
+					references[ref] = symbol;
+					if (reads) reads->push_back(symbol);
+				}
+			} else if (auto bin = dynamic_cast<const BinaryExpr*>(e)) {
+				expr(bin->left, line, reads);
+				expr(bin->right, line, reads);
+				operations.push_back({e, line});
+			} else if (auto neg = dynamic_cast<const NotExpr*>(e)) {
+				expr(neg->operand, line, reads);
+			} else if (auto call = dynamic_cast<const FunctionCall*>(e)) {
+				for (const Expr* arg : call->args) expr(arg, line, reads);
+				check_arity(call, line);
+				operations.push_back({e, line});
+			} else if (auto spawn = dynamic_cast<const SpawnExpr*>(e)) {
+				expr(spawn->call, line, reads);
+			} else if (auto wait = dynamic_cast<const AwaitExpr*>(e)) {
+				expr(wait->task, line, reads);
+			}
+		}
+
+		void check_arity(const FunctionCall* call, int line) {
+			int count = call->args.size();
+			auto builtin = stdlib_signatures.find(call->name);
+			if (builtin != stdlib_signatures.end()) {
+				const BuiltinSignature& s = builtin->second;
+				if (accepts_count(s, count)) return;
+				string expected = s.max_args < 0 ? "at least " + arguments(s.min_args)
+				                : s.min_args == s.max_args ? arguments(s.min_args)
+				                : to_string(s.min_args) + " to " + arguments(s.max_args);
+				error(line, "'" + call->name + "' expects " + expected + ", got " + to_string(count));
+			} else if (const FunctionDefinition* func = find_function(&parser.functionDefinitions, call->name)) {
+				int expected = func->args.size(); // the missing ones take their default values
+				if (count > expected) error(line, "'" + call->name + "' expects at most " + arguments(expected) + ", got " + to_string(count));
+			}
+		}
+
+		int infer(const Expr* e, unordered_map<const Expr*, int>* cache = nullptr) {
+			/**
+			 * @brief The types an expression may evaluate to, given the types inferred for the variables so far.
+			 * @param cache If not null, remembers the result of every subexpression (only valid once the types settled).
+			 */
+			if (!e) return T_ANY;
+			if (cache) {
+				auto it = cache->find(e);
+				if (it != cache->end()) return it->second;
+			}
+			int types = T_ANY;
+			if (dynamic_cast<const IntLiteral*>(e) || dynamic_cast<const SpawnExpr*>(e)) types = T_INT; // a task id for porneste
+			else if (dynamic_cast<const FloatLiteral*>(e)) types = T_FLOAT;
+			else if (dynamic_cast<const StringLiteral*>(e)) types = T_STRING;
+			else if (dynamic_cast<const BoolLiteral*>(e) || dynamic_cast<const NotExpr*>(e)) types = T_BOOL;
+			else if (auto ref = dynamic_cast<const Refrence*>(e)) {
+				auto it = references.find(ref);
+				types = it == references.end() ? T_ANY : it->second->types;
+			} else if (auto bin = dynamic_cast<const BinaryExpr*>(e)) {
+				bool possible;
+				types = binary_result(bin->op, infer(bin->left, cache), infer(bin->right, cache), possible); // none if it always fails
+			} else if (auto call = dynamic_cast<const FunctionCall*>(e)) {
+				auto builtin = stdlib_signatures.find(call->name);
+				if (builtin != stdlib_signatures.end()) types = parse_types(builtin->second.result);
+			}
+			if (cache) (*cache)[e] = types;
+			return types;
+		}
+
+		void infer_all() {
+			/**
+			 * @brief Grows the types of every variable until they settle: an assignment is inferred again whenever a variable
+			 * it reads may hold a new type.
+			 */
+			vector<size_t> work(assignments.size());
+			for (size_t i = 0; i < work.size(); i++) work[i] = work.size() - 1 - i; // in source order
+			while (!work.empty()) {
+				const Assignment& a = assignments[work.back()];
+				work.pop_back();
+				int types = infer(a.value);
+				if (a.op) {
+					bool possible;
+					types = binary_result(string(1, a.op), a.target->types, types, possible);
+				}
+				types |= a.target->types;
+				if (types == a.target->types) continue;
+				a.target->types = types;
+				auto it = readers.find(a.target);
+				if (it != readers.end()) work.insert(work.end(), it->second.begin(), it->second.end());
+			}
+		}
+
+		void check_update(const Assignment& update, int line, unordered_map<const Expr*, int>& cache) {
+			int left = update.target->types, right = infer(update.value, &cache);
+			bool possible;
+			binary_result(string(1, update.op), left, right, possible);
+			if (left && right && !possible) {
+				error(line, "Operator '" + string(1, update.op) + "=' cannot be applied to " + describe(left) + " and " + describe(right));
+			}
+		}
+
+		void check_operation(const Expr* e, int line, unordered_map<const Expr*, int>& cache) {
+			if (auto bin = dynamic_cast<const BinaryExpr*>(e)) {
+				int left = infer(bin->left, &cache), right = infer(bin->right, &cache);
+				bool possible;
+				binary_result(bin->op, left, right, possible);
+				if (left && right && !possible) {
+					error(line, "Operator '" + bin->op + "' cannot be applied to " + describe(left) + " and " + describe(right));
+				}
+			} else if (auto call = dynamic_cast<const FunctionCall*>(e)) {
+				auto builtin = stdlib_signatures.find(call->name);
+				// a wrong number of arguments was already reported by check_arity
+				if (builtin == stdlib_signatures.end() || !accepts_count(builtin->second, call->args.size())) return;
+				int accepted = parse_types(builtin->second.argument);
+				for (size_t i = 0; i < call->args.size(); i++) {
+					int types = infer(call->args[i], &cache);
+					if (types && !(types & accepted)) {
+						error(line, "'" + call->name + "' expects " + describe(accepted) + ", got " + describe(types),
+						      i < call->arg_spans.size() ? call->arg_spans[i] : Span(0, 0));
+					}
+				}
+			}
+		}
+};
+
+vector<SyntaxError> check_program(const Parser& parser) {
+	return Checker(parser).run();
+}
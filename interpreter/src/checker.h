@@ -0,0 +1,22 @@
+/**
+ * @file checker.h
+ * @brief Header file for the static checker of the Roscript interpreter.
+ * `ros --check` looks for the mistakes the runtime would only hit while running, or never report at all: names used but never
+ * declared (they silently read 0), variables never read, calls with the wrong number of arguments, and operations whose
+ * operand types can never work together.
+ * @author Rares-Cosma & Vlad-Oprea
+ * @date 2026-10-18
+ */
+
+#pragma once
+#include "parser.h"
+
+/**
+ * @brief Checks a parsed program without running it.
+ * @param parser The parser holding the program (its AST and function definitions), parsed without syntax errors.
+ * @return The problems found, by line. Errors fail whenever the code runs; warnings are likely mistakes.
+ * @note The types are inferred flow-insensitively: a variable may hold any type it is ever given, so an operation is only
+ * reported when none of the type combinations its operands may have is supported. The check is linear in the program size,
+ * apart from re-inferring the assignments that read a variable whose possible types grew (at most four times per variable).
+ */
+vector<SyntaxError> check_program(const Parser& parser);
@@ -0,0 +1,269 @@
+/**
+ * @file document.cpp
+ * @brief Incremental front end implementation for the Roscript interpreter.
+ * This file contains Document: the per-line lexing with the lexer state carried between lines, the splicing of the re-lexed
+ * tokens into the token list, and the statement by statement re-parse that stops as soon as it is back in step with the old parse.
+ * @see document.h
+ *
+ * @author Rares-Cosma & Vlad-Oprea
+ * @date 2026-10-18
+ */
+#include "document.h"
+#include <algorithm>
+
+static vector<string> split_lines(const string& text) {
+	vector<string> result;
+	size_t begin = 0;
+	while (true) {
+		size_t end = text.find('\n', begin);
+		result.push_back(text.substr(begin, end == string::npos ? string::npos : end - begin));
+		if (end == string::npos) return result;
+		begin = end + 1;
+	}
+}
+
+template <typename T>
+static void splice(vector<T>& into, size_t at, size_t removed, vector<T>& inserted) {
+	/**
+	 * @brief Replaces `removed` elements at `at` by `inserted`, moving the tail of the vector only if the count changes.
+	 */
+	size_t common = min(removed, inserted.size());
+	move(inserted.begin(), inserted.begin() + common, into.begin() + at);
+	if (removed > common) into.erase(into.begin() + at + common, into.begin() + at + removed);
+	else into.insert(into.begin() + at + common, make_move_iterator(inserted.begin() + common), make_move_iterator(inserted.end()));
+}
+
+static bool same_names(const vector<string>& now, const vector<string>& old, size_t& checked) {
+	/**
+	 * @brief Whether the names are the first now.size() of the old ones. Both only grow during a parse, so the first `checked` of
+	 * them matched already and a mismatch stays one: each call only compares the names added since the last.
+	 */
+	if (now.size() > old.size()) return false;
+	while (checked < now.size() && now[checked] == old[checked]) checked++;
+	return checked == now.size();
+}
+
+static void shift_lines(const vector<ASTNode*>& block, int delta);
+
+static void shift_lines(ASTNode* node, int delta) {
+	/**
+	 * @brief Moves a statement and the statements nested in it by delta lines.
+	 */
+	if (node->line) node->line += delta;
+	if (auto ifs = dynamic_cast<IfStatement*>(node)) {
+		shift_lines(ifs->block, delta);
+		for (auto& branch : ifs->elseIfBranches) shift_lines(branch.second, delta);
+		shift_lines(ifs->elseBlock, delta);
+	} else if (auto sw = dynamic_cast<SwitchStatement*>(node)) {
+		for (auto& c : sw->cases) shift_lines(c.second, delta);
+		shift_lines(sw->elseBlock, delta);
+	} else if (auto loop = dynamic_cast<WhileStatement*>(node)) {
+		shift_lines(loop->block, delta);
+	} else if (auto loop = dynamic_cast<DoWhileStatement*>(node)) {
+		shift_lines(loop->block, delta);
+	} else if (auto loop = dynamic_cast<DoUntilStatement*>(node)) {
+		shift_lines(loop->block, delta);
+	} else if (auto loop = dynamic_cast<ForStatement*>(node)) {
+		shift_lines(loop->block, delta);
+	} else if (auto loop = dynamic_cast<ForEachStatement*>(node)) {
+		shift_lines(loop->block, delta);
+	} else if (auto func = dynamic_cast<FunctionDefinition*>(node)) {
+		shift_lines(func->block, delta);
+	}
+}
+
+static void shift_lines(const vector<ASTNode*>& block, int delta) {
+	for (ASTNode* node : block) shift_lines(node, delta);
+}
+
+void Document::relex(size_t index, LexState& state, vector<Token>& out) {
+	/**
+	 * @brief Lexes one line into Tokens carrying its line number and text, like TokenStream::init builds them.
+	 */
+	vector<pair<string, string>> raw;
+	vector<Span> spans;
+	Line& line = lines[index];
+	line.token_count = lex_line(line.text, state, raw, &spans);
+	line.end = state;
+	if (index + 1 == lines.size()) lex_end(state, raw, &spans); // a literal still open at the end is a token of the last line
+
+	string joined;
+	for (size_t i = 0; i < raw.size(); i++) joined += (i ? " " : "") + raw[i].second;
+	for (size_t i = 0; i < raw.size(); i++) {
+		out.push_back({static_cast<int>(index) + 1, joined, move(raw[i].second), move(raw[i].first), spans[i].first, spans[i].second});
+	}
+	relexed_lines++;
+}
+
+void Document::set_text(const string& text) {
+	/**
+	 * @brief Replaces the whole source, lexing and parsing it from scratch.
+	 */
+	parser.reset();
+	statements.clear();
+	token_list.clear();
+	lines.clear();
+	relexed_lines = reparsed_statements = 0;
+
+	for (string& line : split_lines(text)) lines.push_back({move(line)});
+	LexState state;
+	for (size_t i = 0; i < lines.size(); i++) relex(i, state, token_list);
+	parse_from(0, 0, 0, 0);
+}
+
+void Document::edit(int start_line, int start_column, int end_line, int end_column, const string& text) {
+	/**
+	 * @brief Replaces the text between two positions, 0-based lines and columns (the range of an LSP change event).
+	 * @note Lines are re-lexed from the first edited one until one ends in the same state as before (a string literal opened
+	 * or closed by the edit changes the lines after it), then the token list and the statements are patched.
+	 */
+	if (lines.empty()) set_text("");
+	relexed_lines = reparsed_statements = 0;
+
+	int last = lines.size() - 1;
+	start_line = clamp(start_line, 0, last);
+	end_line = clamp(end_line, 0, last);
+	if (make_pair(end_line, end_column) < make_pair(start_line, start_column)) {
+		swap(start_line, end_line);
+		swap(start_column, end_column);
+	}
+	start_column = clamp<int>(start_column, 0, lines[start_line].text.size());
+	end_column = clamp<int>(end_column, 0, lines[end_line].text.size());
+
+	int first_token = 0; // the tokens of the replaced lines are [first_token, end_token)
+	for (int i = 0; i < start_line; i++) first_token += lines[i].token_count;
+	int end_token = first_token;
+	for (int i = start_line; i <= end_line; i++) end_token += lines[i].token_count;
+	bool at_end = end_line == last; // the token of a literal left open at the end belongs to the last line too
+	if (at_end && lines[last].end.in_string) end_token++;
+
+	vector<string> replacement = split_lines(lines[start_line].text.substr(0, start_column) + text + lines[end_line].text.substr(end_column));
+	LexState old_end = lines[end_line].end;
+	vector<Line> inserted;
+	for (string& line : replacement) inserted.push_back({move(line)});
+	splice(lines, start_line, end_line - start_line + 1, inserted);
+	int line_shift = static_cast<int>(replacement.size()) - (end_line - start_line + 1);
+
+	vector<Token> fresh;
+	LexState state = start_line > 0 ? lines[start_line - 1].end : LexState();
+	size_t next = start_line, stop = start_line + replacement.size();
+	while (true) {
+		for (; next < stop; next++) relex(next, state, fresh);
+		if (state == old_end || next >= lines.size()) break;
+		end_token += lines[next].token_count; // the edit changed the state this line starts in, so it is lexed again
+		old_end = lines[next].end;
+		if (next + 1 == lines.size() && old_end.in_string) end_token++;
+		stop = next + 1;
+	}
+
+	int token_shift = static_cast<int>(fresh.size()) - (end_token - first_token);
+	splice(token_list, first_token, end_token - first_token, fresh);
+	if (line_shift != 0) {
+		for (size_t i = first_token + (end_token - first_token) + token_shift; i < token_list.size(); i++) token_list[i].line_nb += line_shift;
+	}
+
+	// start at the statement holding the token before the edit: it may have stopped because of the token that was there
+	size_t statement = 0;
+	if (first_token > 0) {
+		statement = upper_bound(statements.begin(), statements.end(), first_token - 1,
+		                        [](int token, const Statement& s) { return token < s.end_token; }) - statements.begin();
+	}
+	parse_from(statement, end_token, token_shift, line_shift);
+}
+
+void Document::parse_from(size_t statement, int resync_token, int token_shift, int line_shift) {
+	/**
+	 * @brief Re-parses the statements from `statement` on, until the parse is back in step with the old one.
+	 * @param resync_token Old index of the first token after the edit; only statements starting there or later can be kept.
+	 * @param token_shift, line_shift How far the edit moved the tokens and the lines after it.
+	 */
+	size_t old_count = statements.size();
+	int idx = statement < old_count ? statements[statement].first_token : (old_count ? statements.back().end_token : 0);
+	size_t first_node = 0;
+	for (size_t i = 0; i < statement; i++) first_node += statements[i].nodes;
+
+	vector<string> old_variables = parser.parser_variables.names(), old_functions = parser.parser_user_defined_fn.names();
+	vector<ASTNode*> old_definitions = parser.functionDefinitions;
+	if (statement < old_count) {
+		const Statement& s = statements[statement];
+		parser.parser_variables.truncate(s.variables);
+		parser.parser_user_defined_fn.truncate(s.functions);
+		parser.functionDefinitions.resize(s.definitions);
+	}
+
+	size_t same_variables = parser.parser_variables.size(), same_functions = parser.parser_user_defined_fn.size();
+	vector<Statement> fresh;
+	vector<ASTNode*> nodes;
+	size_t keep = statement; // old statements before the first kept one after the edit are replaced
+	while (keep < old_count && statements[keep].first_token < resync_token) keep++;
+	while (idx < static_cast<int>(token_list.size())) {
+		while (keep < old_count && statements[keep].first_token + token_shift < idx) keep++;
+		if (keep < old_count && statements[keep].first_token + token_shift == idx) {
+			const Statement& s = statements[keep];
+			if (s.variables == parser.parser_variables.size() && s.functions == parser.parser_user_defined_fn.size() &&
+			    same_names(parser.parser_variables.names(), old_variables, same_variables) &&
+			    same_names(parser.parser_user_defined_fn.names(), old_functions, same_functions)) {
+				break; // same position, same names declared: the old parse from here on is still right
+			}
+		}
+
+		Statement s;
+		s.first_token = idx;
+		s.variables = parser.parser_variables.size();
+		s.functions = parser.parser_user_defined_fn.size();
+		s.definitions = parser.functionDefinitions.size();
+		size_t errors = parser.errors.size(), before = nodes.size();
+		parser.parse_statement(token_list, idx, nodes); // reports its syntax errors and always moves on
+		s.end_token = idx;
+		s.nodes = nodes.size() - before;
+		s.errors.assign(parser.errors.begin() + errors, parser.errors.end());
+		parser.errors.resize(errors);
+		fresh.push_back(move(s));
+		reparsed_statements++;
+	}
+	if (idx >= static_cast<int>(token_list.size())) keep = old_count;
+
+	size_t end_node = first_node;
+	for (size_t i = statement; i < keep; i++) end_node += statements[i].nodes;
+	for (size_t i = first_node; i < end_node; i++) delete parser.AST[i];
+	splice(parser.AST, first_node, end_node - first_node, nodes);
+
+	long definition_shift = 0;
+	if (keep < old_count) { // the kept statements declare what they declared before
+		definition_shift = static_cast<long>(parser.functionDefinitions.size()) - static_cast<long>(statements[keep].definitions);
+		parser.functionDefinitions.insert(parser.functionDefinitions.end(), old_definitions.begin() + statements[keep].definitions, old_definitions.end());
+		for (size_t i = parser.parser_variables.size(); i < old_variables.size(); i++) parser.parser_variables.declare(old_variables[i]);
+		for (size_t i = parser.parser_user_defined_fn.size(); i < old_functions.size(); i++) parser.parser_user_defined_fn.declare(old_functions[i]);
+	}
+	for (size_t i = keep; i < old_count; i++) {
+		Statement& s = statements[i];
+		s.first_token += token_shift;
+		s.end_token += token_shift;
+		s.definitions += definition_shift;
+		for (SyntaxError& error : s.errors) error.line_nb += line_shift;
+	}
+	if (line_shift != 0) {
+		for (size_t i = first_node + nodes.size(); i < parser.AST.size(); i++) shift_lines(parser.AST[i], line_shift);
+	}
+	splice(statements, statement, keep - statement, fresh);
+}
+
+string Document::text() const {
+	string result;
+	for (size_t i = 0; i < lines.size(); i++) result += (i ? "\n" : "") + lines[i].text;
+	return result;
+}
+
+vector<SyntaxError> Document::diagnostics() const {
+	vector<SyntaxError> result;
+	for (const Statement& s : statements) result.insert(result.end(), s.errors.begin(), s.errors.end());
+	return result;
+}
+
+string Document::errors() const {
+	string result;
+	for (const SyntaxError& error : diagnostics()) {
+		result += "Syntax Error: " + error.message + "\nOn line: " + to_string(error.line_nb) + ": " + error.line + "\n\n";
+	}
+	return result;
+}
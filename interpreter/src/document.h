@@ -0,0 +1,70 @@
+/**
+ * @file document.h
+ * @brief Header file for the incremental front end of the Roscript interpreter.
+ * A Document keeps an open source file lexed and parsed across edits, for editor integrations: an edit re-lexes only the lines
+ * it touched and re-parses only the top level statements around it, reusing the tokens and the AST of everything else.
+ * @author Rares-Cosma & Vlad-Oprea
+ * @date 2026-10-18
+ */
+
+#pragma once
+#include "lexer.h"
+#include "parser.h"
+
+/**
+ * @class Document
+ * @brief One source file with its tokens, AST, declared names and syntax errors, kept up to date edit by edit.
+ * @note The parse of a statement depends on the variables and functions declared before it, so re-parsing goes on past the edit
+ * until a statement starts where an old one did with the same names declared; from there the old statements are kept.
+ */
+class Document {
+	public:
+		Parser parser; // owns the AST, parser.AST holds the top level statements
+
+		Document() { parser.err = &quiet; }
+		Document(const Document&) = delete;
+		Document& operator=(const Document&) = delete;
+
+		void set_text(const string& text);
+		void edit(int start_line, int start_column, int end_line, int end_column, const string& text);
+		string text() const;
+
+		const vector<Token>& tokens() const { return token_list; }
+		const string& line(int index) const { return lines[index].text; } // 0-based
+		int line_count() const { return lines.size(); }
+		vector<SyntaxError> diagnostics() const; // the syntax errors, in source order
+		string errors() const; // the same, formatted as the parser prints them
+
+		int relexed_lines = 0; // lines lexed by the last set_text() or edit()
+		int reparsed_statements = 0; // top level statements parsed by the last set_text() or edit()
+
+	private:
+		/**
+		 * @struct Line
+		 * @brief One source line and its tokens.
+		 */
+		struct Line {
+			string text;
+			int token_count = 0;
+			LexState end{}; // the lexer state after the line, the state the next line starts in
+		};
+
+		/**
+		 * @struct Statement
+		 * @brief One top level statement: the tokens it was parsed from and the parser state before it.
+		 */
+		struct Statement {
+			int first_token = 0, end_token = 0; // the token range [first_token, end_token)
+			int nodes = 0; // AST nodes it produced (0 or 1)
+			size_t variables = 0, functions = 0, definitions = 0; // sizes of the parser's name lists before it
+			vector<SyntaxError> errors; // reported while parsing it
+		};
+
+		vector<Line> lines;
+		vector<Token> token_list; // the tokens of every line, each with its line number and line text
+		vector<Statement> statements; // they cover token_list exactly, in order
+		ostream quiet{nullptr}; // the parser reports into the statements instead of printing
+
+		void relex(size_t index, LexState& state, vector<Token>& out);
+		void parse_from(size_t statement, int resync_token, int token_shift, int line_shift);
+};
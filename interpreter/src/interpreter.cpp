@@ -1,268 +1,1773 @@
 #include "interpreter.h"
+#include "lexer.h"
+#include "thread_pool.h"
+#include "trace.h"
 #include <unordered_map>
+#include <unordered_set>
 #include <chrono>
+#include <fstream>
+#include <sstream>
+#include <exception>
+#include <cerrno>
+#include <climits>
+#include <poll.h>
 
 using namespace chrono;
 
-unordered_map<string,Value> variables; // vector of variables
+inline void loop_back_edge(Context& ctx) {
+    /**
+     * @brief Called once per loop iteration and function call, aborts the script once it went over one of its limits.
+     * @note The clock is only read every 1024 iterations to keep loops cheap.
+     */
+    if (ctx.max_operations && ctx.operations > ctx.max_operations) {
+        throw runtime_error("Operation limit exceeded: more than " + to_string(ctx.max_operations) + " operations");
+    }
+    if (ctx.memory_budget && ctx.memory_budget->exceeded()) {
+        throw runtime_error("Memory limit exceeded: more than " + to_string(ctx.memory_budget->limit) + " bytes");
+    }
+    if ((++ctx.back_edges & 1023) == 0 && steady_clock::now() > ctx.deadline) {
+        throw runtime_error("Time limit exceeded");
+    }
+}
+
+static int range_bound(Expr* expr, Context& ctx) {
+    Value bound = expr->eval(ctx);
+    if (!holds_alternative<int>(bound)) {
+        throw runtime_error("interval expects int bounds");
+    }
+    return get<int>(bound);
+}
+
+static Value reduction_identity(const Value& current, const string& family) {
+    /**
+     * @brief The value each thread of a parallel loop starts a reduction from (0, 1 or "").
+     */
+    if (holds_alternative<int>(current)) return family == "*" ? 1 : 0;
+    if (holds_alternative<float>(current)) return family == "*" ? 1.0f : 0.0f;
+    if (holds_alternative<string>(current) && family == "+") return string();
+    throw runtime_error("Unsupported reduction on a " + string(holds_alternative<string>(current) ? "string" : "bool") + " variable");
+}
+
+void print_ast(const std::vector<ASTNode*>& AST, int indent = 0) {
+    for (const auto& node : AST) {
+        node->get(indent);
+    }
+    cout << string(indent, ' ') << "End of AST" << endl;
+}
+
+static bool reads_input(Expr* expr) {
+    /**
+     * @brief Whether evaluating the expression may call citeste, and so block on the input stream.
+     */
+    if (auto fc = dynamic_cast<FunctionCall*>(expr)) {
+        if (fc->name == "citeste") return true;
+        for (Expr* arg : fc->args) {
+            if (reads_input(arg)) return true;
+        }
+    } else if (auto bin = dynamic_cast<BinaryExpr*>(expr)) {
+        return reads_input(bin->left) || reads_input(bin->right);
+    } else if (auto neg = dynamic_cast<NotExpr*>(expr)) {
+        return reads_input(neg->operand);
+    } else if (auto inlined = dynamic_cast<InlinedCall*>(expr)) {
+        return any_of(inlined->call->args.begin(), inlined->call->args.end(), reads_input);
+    } else if (auto spawn = dynamic_cast<SpawnExpr*>(expr)) {
+        return reads_input(spawn->call);
+    } else if (auto wait = dynamic_cast<AwaitExpr*>(expr)) {
+        return reads_input(wait->task);
+    }
+    return false;
+}
 
-Expr* simplify(Expr* expr) {
-    if (auto ref = dynamic_cast<Refrence*>(expr)) {
-        string refName = get<string>(ref->eval());
+static bool runs_code(Expr* expr) {
+    /**
+     * @brief Whether evaluating the expression may run user code (a call, a task), which could assign any variable.
+     */
+    if (auto fc = dynamic_cast<FunctionCall*>(expr)) {
+        if (stdlib.find(fc->name) == stdlib.end()) return true;
+        for (Expr* arg : fc->args) {
+            if (runs_code(arg)) return true;
+        }
+    } else if (auto bin = dynamic_cast<BinaryExpr*>(expr)) {
+        return runs_code(bin->left) || runs_code(bin->right);
+    } else if (auto neg = dynamic_cast<NotExpr*>(expr)) {
+        return runs_code(neg->operand);
+    } else if (auto inlined = dynamic_cast<InlinedCall*>(expr)) {
+        return any_of(inlined->call->args.begin(), inlined->call->args.end(), runs_code);
+    } else if (dynamic_cast<SpawnExpr*>(expr) || dynamic_cast<AwaitExpr*>(expr)) {
+        return true;
+    }
+    return false;
+}
+
+static bool spawns(Expr* expr) {
+    /**
+     * @brief Whether evaluating the expression may start a task, which can assign globals while a loop of this one runs.
+     */
+    if (dynamic_cast<SpawnExpr*>(expr)) return true;
+    if (auto fc = dynamic_cast<FunctionCall*>(expr)) {
+        return any_of(fc->args.begin(), fc->args.end(), spawns);
+    } else if (auto bin = dynamic_cast<BinaryExpr*>(expr)) {
+        return spawns(bin->left) || spawns(bin->right);
+    } else if (auto neg = dynamic_cast<NotExpr*>(expr)) {
+        return spawns(neg->operand);
+    } else if (auto inlined = dynamic_cast<InlinedCall*>(expr)) {
+        return any_of(inlined->call->args.begin(), inlined->call->args.end(), spawns);
+    } else if (auto wait = dynamic_cast<AwaitExpr*>(expr)) {
+        return spawns(wait->task);
+    }
+    return false;
+}
+
+using ExpressionVisitor = function<void(Expr*&)>;
+using NameVisitor = function<void(const string&)>;
+
+static void visit_statements(vector<ASTNode*>& block, const ExpressionVisitor& expression, const NameVisitor& assigned);
 
-        if (variables.find(refName) != variables.end()) {
-            Value varValue = variables[refName];
+static void visit_statement(ASTNode* node, const ExpressionVisitor& expression, const NameVisitor& assigned) {
+    /**
+     * @brief Visits the expressions of a statement and of the statements nested in it, and the variables they assign.
+     * @note The expressions are passed by reference, so the visitor may replace them. Function definitions are not entered.
+     */
+    if (auto varDecl = dynamic_cast<VariableDeclaration*>(node)) {
+        assigned(varDecl->name);
+        expression(varDecl->value);
+    } else if (auto assign = dynamic_cast<AssignStatement*>(node)) {
+        assigned(assign->name);
+        expression(assign->expr);
+    } else if (auto upd = dynamic_cast<UpdateStatement*>(node)) {
+        assigned(upd->name);
+        expression(upd->expr);
+    } else if (auto inp = dynamic_cast<InputStatement*>(node)) {
+        assigned(inp->name);
+    } else if (auto print = dynamic_cast<PrintStatement*>(node)) {
+        expression(print->expr);
+    } else if (auto ret = dynamic_cast<ReturnStatement*>(node)) {
+        if (ret->expr) expression(ret->expr);
+    } else if (auto ifs = dynamic_cast<IfStatement*>(node)) {
+        expression(ifs->expr);
+        visit_statements(ifs->block, expression, assigned);
+        for (auto& elseIf : ifs->elseIfBranches) {
+            expression(elseIf.first);
+            visit_statements(elseIf.second, expression, assigned);
+        }
+        visit_statements(ifs->elseBlock, expression, assigned);
+    } else if (auto sw = dynamic_cast<SwitchStatement*>(node)) {
+        expression(sw->expr);
+        for (auto& c : sw->cases) visit_statements(c.second, expression, assigned);
+        visit_statements(sw->elseBlock, expression, assigned);
+    } else if (auto loop = dynamic_cast<WhileStatement*>(node)) {
+        expression(loop->expr);
+        visit_statements(loop->block, expression, assigned);
+    } else if (auto loop = dynamic_cast<DoWhileStatement*>(node)) {
+        visit_statements(loop->block, expression, assigned);
+        expression(loop->expr);
+    } else if (auto loop = dynamic_cast<DoUntilStatement*>(node)) {
+        visit_statements(loop->block, expression, assigned);
+        expression(loop->expr);
+    } else if (auto loop = dynamic_cast<ForStatement*>(node)) {
+        visit_statement(loop->init_block, expression, assigned);
+        expression(loop->expr);
+        visit_statements(loop->block, expression, assigned);
+        visit_statement(loop->assign_block, expression, assigned);
+    } else if (auto loop = dynamic_cast<ForEachStatement*>(node)) {
+        assigned(loop->name);
+        if (loop->sequence) expression(loop->sequence);
+        if (loop->start) expression(loop->start);
+        if (loop->end) expression(loop->end);
+        if (loop->step) expression(loop->step);
+        visit_statements(loop->block, expression, assigned);
+    }
+}
 
-            if (holds_alternative<int>(varValue))
-                return new IntLiteral(get<int>(varValue));
-            if (holds_alternative<float>(varValue))
-                return new FloatLiteral(get<float>(varValue));
-            if (holds_alternative<string>(varValue))
-                return new StringLiteral(get<string>(varValue));
+static void visit_statements(vector<ASTNode*>& block, const ExpressionVisitor& expression, const NameVisitor& assigned) {
+    for (ASTNode*& node : block) {
+        if (auto expr = dynamic_cast<Expr*>(node)) { // a call statement
+            expression(expr);
+            node = expr;
         } else {
-            cout << "Variable not found: " << refName << endl;
+            visit_statement(node, expression, assigned);
         }
     }
+}
 
-    else if (auto binExpr = dynamic_cast<BinaryExpr*>(expr)) {
-        binExpr->left = simplify(binExpr->left);
-        binExpr->right = simplify(binExpr->right);
-        return binExpr;
+static void visit_iteration(ASTNode* loop, const ExpressionVisitor& expression, const NameVisitor& assigned) {
+    /**
+     * @brief Like visit_statement, but only the parts of a loop that run every iteration: not the initialization of a
+     * `pentru` nor the string or interval of a `pentru fiecare`, which are evaluated once.
+     */
+    if (auto forStmt = dynamic_cast<ForStatement*>(loop)) {
+        expression(forStmt->expr);
+        visit_statements(forStmt->block, expression, assigned);
+        visit_statement(forStmt->assign_block, expression, assigned);
+    } else if (auto forEach = dynamic_cast<ForEachStatement*>(loop)) {
+        assigned(forEach->name);
+        visit_statements(forEach->block, expression, assigned);
+    } else { // cat timp and repeta: the condition and the block
+        visit_statement(loop, expression, assigned);
     }
-    return expr;
 }
 
-bool condition_to_bool(const Value& conditionValue) {
-    if (holds_alternative<bool>(conditionValue)) {
-        return get<bool>(conditionValue);
-    } else if (holds_alternative<int>(conditionValue)) {
-        return get<int>(conditionValue) != 0;
-    } else if (holds_alternative<float>(conditionValue)) {
-        return get<float>(conditionValue) != 0.0f;
+void SwitchTable::build(const vector<pair<Value, size_t>>& labels) {
+    /**
+     * @brief Fills the table from the labels and their targets. The int labels go in a vector when it is at most about
+     * twice as long as their count, which covers enum-like codes 0..n and small gaps.
+     */
+    long long low = INT_MAX, high = INT_MIN, count = 0;
+    for (const auto& [label, target] : labels) {
+        if (const int* i = get_if<int>(&label)) {
+            low = min<long long>(low, *i);
+            high = max<long long>(high, *i);
+            count++;
+        }
+    }
+    bool use_dense = count > 0 && high - low + 1 <= max(2 * count, 16LL);
+    if (use_dense) {
+        first = low;
+        dense.assign(high - low + 1, otherwise);
+    }
+    for (const auto& [label, target] : labels) {
+        if (const int* i = get_if<int>(&label)) {
+            if (use_dense) dense[*i - low] = target;
+            else ints[*i] = target;
+        } else {
+            strings[get<string>(label)] = target;
+        }
     }
-    return false; // default case
 }
 
-void print_ast(const std::vector<ASTNode*>& AST, int indent = 0) {
-    for (const auto& node : AST) {
-        node->get(indent);
+size_t SwitchTable::find(const Value& value) const {
+    /**
+     * @brief The target for a value. A float matches the int label it equals, as it would with ==.
+     */
+    int key;
+    if (const int* i = get_if<int>(&value)) {
+        key = *i;
+    } else if (const float* f = get_if<float>(&value)) {
+        if (!(*f >= -2147483648.0f && *f < 2147483648.0f) || static_cast<float>(static_cast<int>(*f)) != *f) return otherwise;
+        key = static_cast<int>(*f);
+    } else if (const string* s = get_if<string>(&value)) {
+        auto it = strings.find(*s);
+        return it == strings.end() ? otherwise : it->second;
+    } else {
+        return otherwise;
     }
-    cout << string(indent, ' ') << "End of AST" << endl;
+    if (!dense.empty()) {
+        long long at = static_cast<long long>(key) - first;
+        return at >= 0 && at < static_cast<long long>(dense.size()) ? dense[at] : otherwise;
+    }
+    auto it = ints.find(key);
+    return it == ints.end() ? otherwise : it->second;
 }
 
-unordered_map<string, microseconds> node_times;
-unordered_map<string, int> node_counts;
+/**
+ * @class BlockScoper
+ * @brief Gives the variables declared in a nested block hidden slots of their own, "#x@n" for a `var x`, renaming the
+ * uses that see the declaration.
+ * @note The slots live in the same map as the frame's other variables but under names no source can spell, so a function
+ * called from inside the block reads and writes the global x, not the block's, and releasing the block (BLOCK_EXIT) only
+ * erases the slot. A chunk's own level is not renamed: those are the globals or the function's locals.
+ */
+class BlockScoper {
+    public:
+        BlockScoper(size_t& slots) : slots(slots) {}
 
-void interpret(std::vector<ASTNode*> AST, bool fprint_ast, bool profiler, bool print_pdata) {
-    if (fprint_ast){
-        cout << "AST:" << endl;
-        print_ast(AST);
+        void chunk(vector<ASTNode*>& nodes) {
+            for (ASTNode* node : nodes) statement(node);
+        }
+
+    private:
+        size_t& slots; // hidden slots made so far, numbering them
+        vector<unordered_map<string, string>> scopes; // source name -> slot, for every enclosing block, innermost last
+
+        void block(vector<ASTNode*>& nodes) {
+            /**
+             * @brief A block compiled by scoped_block, whose declarations end with it.
+             */
+            scopes.emplace_back();
+            chunk(nodes);
+            scopes.pop_back();
+        }
+
+        void use(string& name) const {
+            for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope) {
+                auto it = scope->find(name);
+                if (it != scope->end()) {
+                    name = it->second;
+                    return;
+                }
+            }
+        }
+
+        void declare(string& name) {
+            if (scopes.empty()) return;
+            string& slot = scopes.back()[name]; // declared again in the same block, it is the same variable
+            if (slot.empty()) slot = "#" + name + "@" + to_string(slots++);
+            name = slot;
+        }
+
+        void expression(Expr* expr) {
+            if (auto ref = dynamic_cast<Refrence*>(expr)) {
+                use(ref->name);
+            } else if (auto bin = dynamic_cast<BinaryExpr*>(expr)) {
+                expression(bin->left);
+                expression(bin->right);
+            } else if (auto neg = dynamic_cast<NotExpr*>(expr)) {
+                expression(neg->operand);
+            } else if (auto fc = dynamic_cast<FunctionCall*>(expr)) {
+                for (Expr* arg : fc->args) expression(arg);
+            } else if (auto spawn = dynamic_cast<SpawnExpr*>(expr)) {
+                for (Expr* arg : spawn->call->args) expression(arg);
+            } else if (auto wait = dynamic_cast<AwaitExpr*>(expr)) {
+                expression(wait->task);
+            }
+        }
+
+        void statement(ASTNode* node) {
+            /**
+             * @brief Renames a statement in the order it runs: a declaration is seen after its initializer, so
+             * `var x = x + 1;` in a block reads the outer x.
+             */
+            if (auto expr = dynamic_cast<Expr*>(node)) {
+                expression(expr);
+            } else if (auto varDecl = dynamic_cast<VariableDeclaration*>(node)) {
+                if (varDecl->value) expression(varDecl->value);
+                declare(varDecl->name);
+            } else if (auto assign = dynamic_cast<AssignStatement*>(node)) {
+                expression(assign->expr);
+                use(assign->name);
+            } else if (auto upd = dynamic_cast<UpdateStatement*>(node)) {
+                expression(upd->expr);
+                use(upd->name);
+            } else if (auto inp = dynamic_cast<InputStatement*>(node)) {
+                use(inp->name);
+            } else if (auto print = dynamic_cast<PrintStatement*>(node)) {
+                expression(print->expr);
+            } else if (auto ret = dynamic_cast<ReturnStatement*>(node)) {
+                if (ret->expr) expression(ret->expr);
+            } else if (auto ifs = dynamic_cast<IfStatement*>(node)) {
+                expression(ifs->expr);
+                block(ifs->block);
+                for (auto& elseIf : ifs->elseIfBranches) {
+                    expression(elseIf.first);
+                    block(elseIf.second);
+                }
+                block(ifs->elseBlock);
+            } else if (auto sw = dynamic_cast<SwitchStatement*>(node)) {
+                expression(sw->expr);
+                for (auto& c : sw->cases) block(c.second);
+                block(sw->elseBlock);
+            } else if (auto loop = dynamic_cast<WhileStatement*>(node)) {
+                expression(loop->expr);
+                block(loop->block);
+            } else if (auto loop = dynamic_cast<DoWhileStatement*>(node)) {
+                block(loop->block);
+                expression(loop->expr);
+            } else if (auto loop = dynamic_cast<DoUntilStatement*>(node)) {
+                block(loop->block);
+                expression(loop->expr);
+            } else if (auto loop = dynamic_cast<ForStatement*>(node)) {
+                statement(loop->init_block); // a `var` there belongs to the enclosing block
+                expression(loop->expr);
+                block(loop->block);
+                statement(loop->assign_block);
+            } else if (auto loop = dynamic_cast<ForEachStatement*>(node)) {
+                for (Expr* bound : {loop->sequence, loop->start, loop->end, loop->step}) {
+                    if (bound) expression(bound);
+                }
+                for (auto& reduction : loop->reductions) use(reduction.first);
+                declare(loop->name); // like the `pentru` initialization, in the enclosing block
+                for (string& local : loop->locals) use(local);
+                block(loop->block);
+            }
+        }
+};
+
+/**
+ * @class Inliner
+ * @brief Replaces the calls of small user functions by InlinedCalls, so they cost no frame.
+ * @note A function is inlined if its body is a single `returneaza expr;` and expr and the parameter defaults only use
+ * operators, pure builtins and calls of functions inlined in turn (so never recursion), within a size budget. They may read
+ * globals too, unless the calling function has a variable of the same name, which would hide the global.
+ */
+class Inliner {
+    public:
+        Inliner(const vector<ASTNode*>& functions, size_t& slots) : functions(functions), slots(slots) {}
+
+        void block(vector<ASTNode*>& nodes, const unordered_set<string>& locals) {
+            /**
+             * @brief Inlines the calls in the statements of a chunk. `locals` are the names its frame may declare.
+             */
+            visit_statements(nodes, [&](Expr*& expr) { calls(expr, locals); }, [](const string&) {});
+        }
+
+    private:
+        static const size_t budget = 32; // nodes of an inlined expression, with the ones inlined into it
+
+        /**
+         * @struct Inlinable
+         * @brief What inlining a function takes: its size once inlined (0 if it cannot be) and the globals it reads.
+         */
+        struct Inlinable {
+            size_t size = 0;
+            unordered_set<string> reads;
+        };
+
+        const vector<ASTNode*>& functions;
+        unordered_map<const FunctionDefinition*, Inlinable> inlinable;
+        size_t& slots; // hidden slots made so far, numbering the parameter slots
+
+        const FunctionDefinition* callee(FunctionCall* fc) const {
+            return stdlib.find(fc->name) == stdlib.end() ? find_function(&functions, fc->name) : nullptr;
+        }
+
+        static ReturnStatement* returned(const FunctionDefinition* func) {
+            return func->block.size() == 1 ? dynamic_cast<ReturnStatement*>(func->block[0]) : nullptr;
+        }
+
+        const Inlinable& measure(const FunctionDefinition* func) {
+            /**
+             * @brief Sizes a function once. A function met again while it is being sized calls itself: it stays at size 0.
+             */
+            auto found = inlinable.find(func);
+            if (found != inlinable.end()) return found->second;
+            inlinable[func];
+            ReturnStatement* ret = returned(func);
+            Inlinable result;
+            bool fits = ret && ret->expr;
+            unordered_set<string> params; // a default only sees the parameters before it, like when the frame is bound
+            for (ASTNode* node : func->args) {
+                auto* param = static_cast<VariableDeclaration*>(node);
+                fits = fits && measure(param->value, params, result);
+                params.insert(param->name);
+            }
+            fits = fits && measure(ret->expr, params, result);
+            if (!fits) result = Inlinable();
+            return inlinable[func] = move(result);
+        }
+
+        bool measure(Expr* expr, const unordered_set<string>& params, Inlinable& result) {
+            if (auto inlined = dynamic_cast<InlinedCall*>(expr)) return measure(inlined->call, params, result); // inlined already
+            if (++result.size > budget) return false;
+            if (auto ref = dynamic_cast<Refrence*>(expr)) {
+                if (!params.count(ref->name)) result.reads.insert(ref->name);
+                return true;
+            } else if (auto bin = dynamic_cast<BinaryExpr*>(expr)) {
+                return measure(bin->left, params, result) && measure(bin->right, params, result);
+            } else if (auto neg = dynamic_cast<NotExpr*>(expr)) {
+                return measure(neg->operand, params, result);
+            } else if (auto fc = dynamic_cast<FunctionCall*>(expr)) {
+                for (Expr* arg : fc->args) {
+                    if (!measure(arg, params, result)) return false;
+                }
+                if (const FunctionDefinition* func = callee(fc)) {
+                    const Inlinable& nested = measure(func);
+                    if (!nested.size || fc->args.size() > func->args.size()) return false;
+                    result.size += nested.size;
+                    result.reads.insert(nested.reads.begin(), nested.reads.end());
+                    return result.size <= budget;
+                }
+                auto builtin = stdlib_signatures.find(fc->name);
+                return builtin != stdlib_signatures.end() && builtin->second.pure;
+            }
+            return dynamic_cast<IntLiteral*>(expr) || dynamic_cast<FloatLiteral*>(expr) || dynamic_cast<StringLiteral*>(expr) ||
+                   dynamic_cast<BoolLiteral*>(expr);
+        }
+
+        void calls(Expr*& expr, const unordered_set<string>& locals) {
+            /**
+             * @brief Inlines the calls in an expression, innermost first.
+             */
+            if (auto bin = dynamic_cast<BinaryExpr*>(expr)) {
+                calls(bin->left, locals);
+                calls(bin->right, locals);
+            } else if (auto neg = dynamic_cast<NotExpr*>(expr)) {
+                calls(neg->operand, locals);
+            } else if (auto spawn = dynamic_cast<SpawnExpr*>(expr)) {
+                for (Expr*& arg : spawn->call->args) calls(arg, locals); // the task itself still runs the function
+            } else if (auto wait = dynamic_cast<AwaitExpr*>(expr)) {
+                calls(wait->task, locals);
+            } else if (auto fc = dynamic_cast<FunctionCall*>(expr)) {
+                for (Expr*& arg : fc->args) calls(arg, locals);
+                const FunctionDefinition* func = callee(fc);
+                if (!func || fc->args.size() > func->args.size()) return; // too many arguments is still reported by the call
+                const Inlinable& info = measure(func);
+                if (!info.size || any_of(info.reads.begin(), info.reads.end(), [&](const string& name) { return locals.count(name); })) {
+                    return;
+                }
+                expr = inline_call(fc, func);
+            }
+        }
+
+        InlinedCall* inline_call(FunctionCall* fc, const FunctionDefinition* func) {
+            auto* inlined = new InlinedCall(fc);
+            unordered_map<string, string> renamed; // parameter name -> slot
+            for (size_t i = 0; i < func->args.size(); i++) {
+                auto* param = static_cast<VariableDeclaration*>(func->args[i]);
+                if (i >= fc->args.size()) inlined->defaults.push_back(copy(param->value, renamed));
+                inlined->slots.push_back("#" + param->name + "@" + to_string(slots++));
+                renamed[param->name] = inlined->slots.back();
+            }
+            inlined->body = copy(returned(func)->expr, renamed);
+            const Inlinable& info = measure(func);
+            inlined->reads.assign(info.reads.begin(), info.reads.end());
+            return inlined;
+        }
+
+        Expr* copy(Expr* expr, const unordered_map<string, string>& renamed) {
+            /**
+             * @brief Copies an expression of the inlined function into the call site: the parameters become their slots and
+             * the calls it makes are inlined too.
+             */
+            if (auto inlined = dynamic_cast<InlinedCall*>(expr)) {
+                return copy(inlined->call, renamed); // inlined again, its parameters need slots of their own
+            } else if (auto ref = dynamic_cast<Refrence*>(expr)) {
+                auto it = renamed.find(ref->name);
+                return new Refrence(it == renamed.end() ? ref->name : it->second);
+            } else if (auto logic = dynamic_cast<LogicalExpr*>(expr)) {
+                return new LogicalExpr(copy(logic->left, renamed), logic->op, copy(logic->right, renamed));
+            } else if (auto bin = dynamic_cast<BinaryExpr*>(expr)) {
+                return new BinaryExpr(copy(bin->left, renamed), bin->op, copy(bin->right, renamed));
+            } else if (auto neg = dynamic_cast<NotExpr*>(expr)) {
+                return new NotExpr(copy(neg->operand, renamed));
+            } else if (auto fc = dynamic_cast<FunctionCall*>(expr)) {
+                vector<Expr*> args;
+                for (Expr* arg : fc->args) args.push_back(copy(arg, renamed));
+                auto* call = new FunctionCall(fc->name, move(args));
+                const FunctionDefinition* func = callee(call);
+                return func ? static_cast<Expr*>(inline_call(call, func)) : call;
+            }
+            return expr->clone(); // a literal
+        }
+};
+
+/**
+ * @class ChunkCompiler
+ * @brief Lowers statements into the instructions of a chunk, turning every loop and branch into jumps.
+ */
+class ChunkCompiler {
+    public:
+        ChunkCompiler(Program& program, const vector<ASTNode*>& functions, bool tasks) : program(program), functions(functions), tasks(tasks) {}
+
+        void block(const vector<ASTNode*>& nodes, Chunk& chunk) {
+            for (ASTNode* node : nodes) {
+                statement(node, chunk);
+            }
+        }
+
+        void scoped_block(const vector<ASTNode*>& nodes, Chunk& chunk, const char* node_type) {
+            /**
+             * @brief Compiles a nested block. If it declares variables, they are released when it ends, every iteration for a loop body.
+             */
+            bool declares = any_of(nodes.begin(), nodes.end(), [](ASTNode* node) {
+                auto loop = dynamic_cast<ForStatement*>(node);
+                return dynamic_cast<VariableDeclaration*>(node) || dynamic_cast<ForEachStatement*>(node) ||
+                       (loop && dynamic_cast<VariableDeclaration*>(loop->init_block));
+            });
+            if (declares) {
+                emit(chunk, Instruction{OpCode::BLOCK_ENTER, node_type});
+                blocks++;
+            }
+            block(nodes, chunk);
+            if (declares) {
+                blocks--;
+                emit(chunk, Instruction{OpCode::BLOCK_EXIT, node_type});
+            }
+        }
+
+    private:
+        Program& program;
+        const vector<ASTNode*>& functions;
+        bool tasks; // the program starts tasks, which may assign globals between any two iterations of a loop
+
+        int line = 0; // line of the statement being compiled, inherited by the nodes nested in it
+
+        /**
+         * @struct Loop
+         * @brief The jumps of the `opreste` and `continua` statements of a loop being compiled, patched once its end is known.
+         */
+        struct Loop {
+            size_t blocks; // the scoped blocks open around the loop: the ones opened since are left by its jumps
+            vector<size_t> breaks, continues;
+        };
+        vector<Loop> loops; // innermost last
+        size_t blocks = 0; // scoped blocks open at the statement being compiled
+
+        void hoist_invariants(ASTNode* loop, Chunk& chunk, const char* node_type) {
+            /**
+             * @brief Loop-invariant code motion: replaces the expressions of the loop whose value no iteration can change by
+             * InvariantExprs, and emits the FORGET that has each entry into the loop compute them once.
+             * @note Invariant means reading only variables the loop never assigns, through operators and pure builtins (lungime,
+             * sqrt, the conversions...). A loop that runs user code hoists nothing, since a call may assign any global, and
+             * neither does any loop of a program that starts tasks. Nested loops are visited too: what does not change in the
+             * outer loop is computed once per entry into the outer loop.
+             */
+            if (tasks) return;
+            unordered_set<string> assigned;
+            bool opaque = false;
+            visit_iteration(loop, [&](Expr*& expr) { opaque = opaque || runs_code(expr); },
+                            [&](const string& name) { assigned.insert(name); });
+            if (opaque) return;
+            Instruction forget{OpCode::FORGET, node_type};
+            visit_iteration(loop, [&](Expr*& expr) {
+                if (invariant(expr, assigned, forget.args)) hoist(expr, forget.args);
+            }, [](const string&) {});
+            if (!forget.args.empty()) emit(chunk, move(forget));
+        }
+
+        bool invariant(Expr*& expr, const unordered_set<string>& assigned, vector<Expr*>& hoisted) {
+            /**
+             * @brief Whether the expression is loop-invariant. If it is not, its largest invariant parts are hoisted instead.
+             */
+            if (dynamic_cast<IntLiteral*>(expr) || dynamic_cast<FloatLiteral*>(expr) || dynamic_cast<StringLiteral*>(expr) ||
+                dynamic_cast<BoolLiteral*>(expr) || dynamic_cast<InvariantExpr*>(expr)) {
+                return true;
+            }
+            if (auto ref = dynamic_cast<Refrence*>(expr)) return assigned.count(ref->name) == 0;
+            vector<Expr**> parts;
+            bool pure = true;
+            if (auto bin = dynamic_cast<BinaryExpr*>(expr)) {
+                parts = {&bin->left, &bin->right};
+            } else if (auto neg = dynamic_cast<NotExpr*>(expr)) {
+                parts = {&neg->operand};
+            } else if (auto inlined = dynamic_cast<InlinedCall*>(expr)) {
+                pure = none_of(inlined->reads.begin(), inlined->reads.end(), [&](const string& name) { return assigned.count(name); });
+                for (Expr*& arg : inlined->call->args) parts.push_back(&arg);
+            } else if (auto fc = dynamic_cast<FunctionCall*>(expr)) {
+                auto builtin = stdlib_signatures.find(fc->name);
+                pure = builtin != stdlib_signatures.end() && builtin->second.pure;
+                for (Expr*& arg : fc->args) parts.push_back(&arg);
+            } else {
+                return false;
+            }
+            vector<Expr**> invariant_parts;
+            for (Expr** part : parts) {
+                if (invariant(*part, assigned, hoisted)) invariant_parts.push_back(part);
+            }
+            if (pure && invariant_parts.size() == parts.size()) return true;
+            for (Expr** part : invariant_parts) hoist(*part, hoisted);
+            return false;
+        }
+
+        void hoist(Expr*& expr, vector<Expr*>& hoisted) {
+            // a literal or a variable is read as cheaply as the cached value would be
+            if (!dynamic_cast<BinaryExpr*>(expr) && !dynamic_cast<NotExpr*>(expr) && !dynamic_cast<FunctionCall*>(expr) &&
+                !dynamic_cast<InlinedCall*>(expr)) {
+                return;
+            }
+            expr = new InvariantExpr(expr, "#" + to_string(program.hidden++));
+            hoisted.push_back(expr);
+        }
+
+        void loop_body(const vector<ASTNode*>& nodes, Chunk& chunk, const char* node_type) {
+            loops.push_back({blocks, {}, {}});
+            scoped_block(nodes, chunk, node_type);
+        }
+
+        void end_loop(Chunk& chunk, size_t continue_target, size_t break_target) {
+            patch(chunk, loops.back().continues, continue_target);
+            patch(chunk, loops.back().breaks, break_target);
+            loops.pop_back();
+        }
+
+        void loop_jump(Chunk& chunk, bool stop) {
+            /**
+             * @brief Emits `opreste` or `continua`: a plain jump, after releasing the blocks it leaves in the loop body.
+             */
+            Loop& loop = loops.back();
+            const char* node_type = stop ? "BreakStatement" : "ContinueStatement";
+            for (size_t i = loop.blocks; i < blocks; i++) emit(chunk, Instruction{OpCode::BLOCK_EXIT, node_type});
+            (stop ? loop.breaks : loop.continues).push_back(jump(chunk, OpCode::JUMP, nullptr, node_type));
+        }
+
+        size_t emit(Chunk& chunk, Instruction ins) {
+            ins.line = line;
+            chunk.code.push_back(move(ins));
+            return chunk.code.size() - 1;
+        }
+
+        const FunctionDefinition* user_function(Expr* expr) const {
+            /**
+             * @brief The user function called by the expression, if the expression is nothing but that call.
+             */
+            auto fc = dynamic_cast<FunctionCall*>(expr);
+            if (!fc || stdlib.find(fc->name) != stdlib.end()) return nullptr;
+            return find_function(&functions, fc->name);
+        }
+
+        static FunctionCall* printed(Expr* expr) {
+            /**
+             * @brief The call if it is `afiseaza(...)` of variables and literals only, which can be printed as they are read:
+             * nothing in between can fail or print.
+             */
+            auto fc = dynamic_cast<FunctionCall*>(expr);
+            if (!fc || fc->name != "afiseaza") return nullptr;
+            for (Expr* arg : fc->args) {
+                if (operand(arg).expr) return nullptr;
+            }
+            return fc;
+        }
+
+        static BinaryExpr* updates(Expr* expr, const string& name) {
+            /**
+             * @brief The expression if it is `name op x` with an arithmetic op, so `s = s + x` can run in place like `s += x`
+             * instead of copying s twice. Only when x cannot run user code that assigns s in between.
+             */
+            auto bin = dynamic_cast<BinaryExpr*>(expr);
+            if (!bin || bin->op.size() != 1 || string("+-*/").find(bin->op[0]) == string::npos) return nullptr;
+            auto ref = dynamic_cast<Refrence*>(bin->left);
+            if (!ref || ref->name != name || runs_code(bin->right)) return nullptr;
+            return bin;
+        }
+
+        static Operand operand(Expr* expr) {
+            /**
+             * @brief How a fused instruction reads an expression: variables and literals need no evaluation.
+             */
+            Operand result;
+            if (auto ref = dynamic_cast<Refrence*>(expr)) result.variable = &ref->name;
+            else if (auto literal = dynamic_cast<IntLiteral*>(expr)) result.constant = literal->value;
+            else if (auto literal = dynamic_cast<FloatLiteral*>(expr)) result.constant = literal->value;
+            else if (auto literal = dynamic_cast<StringLiteral*>(expr)) result.constant = literal->value;
+            else if (auto literal = dynamic_cast<BoolLiteral*>(expr)) result.constant = literal->value;
+            else result.expr = expr;
+            return result;
+        }
+
+        static bool comparison(const string& op, Compare& compare) {
+            static const unordered_map<string, Compare> comparisons = {
+                {"<", Compare::LT}, {"<=", Compare::LE}, {">", Compare::GT}, {">=", Compare::GE}, {"==", Compare::EQ}, {"!=", Compare::NE},
+            };
+            auto it = comparisons.find(op);
+            if (it == comparisons.end()) return false;
+            compare = it->second;
+            return true;
+        }
+
+        void update(Expr* operand, const string& name, char op, const char* node_type, Chunk& chunk) {
+            Instruction ins{OpCode::UPDATE, node_type, operand};
+            ins.name = name;
+            ins.update = op;
+            ins.operands = {ChunkCompiler::operand(operand)}; // `i++` adds the constant 1, nothing is evaluated
+            ins.reads_input = reads_input(operand);
+            emit(chunk, move(ins));
+        }
+
+        void store(Expr* expr, const string& name, bool declare, const char* node_type, Chunk& chunk) {
+            /**
+             * @brief Emits `name = expr`. A call to a user function becomes a CALL and a whole `asteapta` an AWAIT,
+             * so the running task can push a frame or suspend instead of recursing on the native stack.
+             */
+            if (const FunctionDefinition* func = user_function(expr)) {
+                Instruction ins{OpCode::CALL, node_type};
+                ins.name = name;
+                ins.declare = declare;
+                ins.function = func;
+                ins.args = static_cast<FunctionCall*>(expr)->args;
+                ins.reads_input = reads_input(expr);
+                emit(chunk, move(ins));
+            } else if (auto wait = dynamic_cast<AwaitExpr*>(expr)) {
+                Instruction ins{OpCode::AWAIT, node_type, wait->task};
+                ins.name = name;
+                ins.declare = declare;
+                ins.reads_input = reads_input(expr);
+                emit(chunk, move(ins));
+            } else if (BinaryExpr* bin = !declare ? updates(expr, name) : nullptr) {
+                update(bin->right, name, bin->op[0], node_type, chunk);
+            } else {
+                Instruction ins{declare ? OpCode::DECLARE : OpCode::ASSIGN, node_type, expr};
+                ins.name = name;
+                ins.reads_input = reads_input(expr);
+                emit(chunk, move(ins));
+            }
+        }
+
+        size_t jump(Chunk& chunk, OpCode op, Expr* condition, const char* node_type, size_t target = 0) {
+            /**
+             * @brief Emits a jump. A condition that is a comparison becomes a compare-and-branch, which reads its operands in
+             * place and compares two ints directly instead of going through a bool Value.
+             */
+            Instruction ins{op, node_type, condition};
+            ins.target = target;
+            ins.reads_input = condition && reads_input(condition);
+            auto bin = dynamic_cast<BinaryExpr*>(condition);
+            if (bin && op != OpCode::JUMP && !dynamic_cast<LogicalExpr*>(bin) && comparison(bin->op, ins.compare)) {
+                ins.op = op == OpCode::JUMP_IF_TRUE ? OpCode::COMPARE_JUMP_IF_TRUE : OpCode::COMPARE_JUMP_IF_FALSE;
+                ins.operands = {operand(bin->left), operand(bin->right)};
+                // the left variable is read after the right operand is evaluated: if that can assign it, read a copy first
+                if (ins.operands[0].variable && runs_code(bin->right)) ins.operands[0] = Operand{nullptr, bin->left, Value()};
+            }
+            return emit(chunk, move(ins));
+        }
+
+        static void patch(Chunk& chunk, const vector<size_t>& jumps, size_t target) {
+            for (size_t at : jumps) chunk.code[at].target = target;
+        }
+
+        void branch(Chunk& chunk, Expr* condition, bool when, vector<size_t>& exits, const char* node_type) {
+            /**
+             * @brief Emits the jumps taken when the condition is `when`; otherwise execution falls through past them.
+             * The jumps are added to exits, for the caller to patch. `si`, `sau` and `nu` become control flow instead of
+             * values: every operand is a jump of its own, and the ones after a deciding operand are never evaluated.
+             */
+            if (auto neg = dynamic_cast<NotExpr*>(condition)) {
+                branch(chunk, neg->operand, !when, exits, node_type);
+            } else if (auto logic = dynamic_cast<LogicalExpr*>(condition)) {
+                if (logic->conjunction != when) { // the left operand alone may decide: false si ..., true sau ...
+                    branch(chunk, logic->left, when, exits, node_type);
+                    branch(chunk, logic->right, when, exits, node_type);
+                } else { // the left operand decides only the other way: then the right one is skipped and the jump not taken
+                    vector<size_t> decided;
+                    branch(chunk, logic->left, !when, decided, node_type);
+                    branch(chunk, logic->right, when, exits, node_type);
+                    for (size_t exit : decided) chunk.code[exit].target = chunk.code.size();
+                }
+            } else {
+                exits.push_back(jump(chunk, when ? OpCode::JUMP_IF_TRUE : OpCode::JUMP_IF_FALSE, condition, node_type));
+            }
+        }
+
+        void statement(ASTNode* node, Chunk& chunk) {
+            int outer_line = line;
+            if (node->line) line = node->line;
+            compile_statement(node, chunk);
+            line = outer_line;
+        }
+
+        void compile_statement(ASTNode* node, Chunk& chunk) {
+            if (auto varDecl = dynamic_cast<VariableDeclaration*>(node)) {
+                store(varDecl->value, varDecl->name, true, "VariableDeclaration", chunk);
+            } else if (auto assign = dynamic_cast<AssignStatement*>(node)) {
+                store(assign->expr, assign->name, false, "AssignStatement", chunk);
+            } else if (auto upd = dynamic_cast<UpdateStatement*>(node)) {
+                update(upd->expr, upd->name, upd->op, "UpdateStatement", chunk);
+            } else if (auto print = dynamic_cast<PrintStatement*>(node)) {
+                Instruction ins{OpCode::PRINT, "PrintStatement", print->expr};
+                ins.reads_input = reads_input(print->expr);
+                emit(chunk, move(ins));
+            } else if (auto inp = dynamic_cast<InputStatement*>(node)) {
+                Instruction ins{OpCode::INPUT, "InputStatement"};
+                ins.name = inp->name;
+                ins.reads_input = true;
+                emit(chunk, move(ins));
+            } else if (auto ret = dynamic_cast<ReturnStatement*>(node)) {
+                Instruction ins{OpCode::RETURN, "ReturnStatement", ret->expr};
+                ins.reads_input = ret->expr && reads_input(ret->expr);
+                emit(chunk, move(ins));
+            } else if (auto sw = dynamic_cast<SwitchStatement*>(node)) {
+                program.switches.emplace_back();
+                SwitchTable& table = program.switches.back();
+                Instruction ins{OpCode::SWITCH, "SwitchStatement", sw->expr};
+                ins.table = &table;
+                ins.reads_input = reads_input(sw->expr);
+                emit(chunk, move(ins));
+                vector<pair<Value, size_t>> labels;
+                vector<size_t> exits;
+                for (size_t i = 0; i < sw->cases.size(); i++) {
+                    for (const Value& label : sw->cases[i].first) labels.push_back({label, chunk.code.size()});
+                    scoped_block(sw->cases[i].second, chunk, "SwitchStatement");
+                    if (i + 1 < sw->cases.size() || !sw->elseBlock.empty()) {
+                        exits.push_back(jump(chunk, OpCode::JUMP, nullptr, "SwitchStatement"));
+                    }
+                }
+                table.otherwise = chunk.code.size();
+                scoped_block(sw->elseBlock, chunk, "SwitchStatement");
+                patch(chunk, exits, chunk.code.size());
+                table.build(labels);
+            } else if (dynamic_cast<BreakStatement*>(node)) {
+                loop_jump(chunk, true);
+            } else if (dynamic_cast<ContinueStatement*>(node)) {
+                loop_jump(chunk, false);
+            } else if (dynamic_cast<FunctionDefinition*>(node)) {
+                // compiled into its own chunk by compile_program
+            } else if (auto whileStmt = dynamic_cast<WhileStatement*>(node)) {
+                hoist_invariants(whileStmt, chunk, "WhileStatement");
+                size_t loop = chunk.code.size();
+                vector<size_t> exits;
+                branch(chunk, whileStmt->expr, false, exits, "WhileStatement");
+                loop_body(whileStmt->block, chunk, "WhileStatement");
+                jump(chunk, OpCode::JUMP, nullptr, "WhileStatement", loop);
+                patch(chunk, exits, chunk.code.size());
+                end_loop(chunk, loop, chunk.code.size());
+            } else if (auto doWhileStmt = dynamic_cast<DoWhileStatement*>(node)) {
+                hoist_invariants(doWhileStmt, chunk, "DoWhileStatement");
+                size_t loop = chunk.code.size();
+                loop_body(doWhileStmt->block, chunk, "DoWhileStatement");
+                size_t condition = chunk.code.size();
+                vector<size_t> repeats;
+                branch(chunk, doWhileStmt->expr, true, repeats, "DoWhileStatement");
+                patch(chunk, repeats, loop);
+                end_loop(chunk, condition, chunk.code.size());
+            } else if (auto doUntilStmt = dynamic_cast<DoUntilStatement*>(node)) {
+                hoist_invariants(doUntilStmt, chunk, "DoUntilStatement");
+                size_t loop = chunk.code.size();
+                loop_body(doUntilStmt->block, chunk, "DoUntilStatement");
+                size_t condition = chunk.code.size();
+                vector<size_t> repeats;
+                branch(chunk, doUntilStmt->expr, false, repeats, "DoUntilStatement");
+                patch(chunk, repeats, loop);
+                end_loop(chunk, condition, chunk.code.size());
+            } else if (auto forStmt = dynamic_cast<ForStatement*>(node)) {
+                statement(forStmt->init_block, chunk);
+                hoist_invariants(forStmt, chunk, "ForStatement");
+                size_t loop = chunk.code.size();
+                vector<size_t> exits;
+                branch(chunk, forStmt->expr, false, exits, "ForStatement");
+                loop_body(forStmt->block, chunk, "ForStatement");
+                size_t step = chunk.code.size();
+                statement(forStmt->assign_block, chunk);
+                jump(chunk, OpCode::JUMP, nullptr, "ForStatement", loop);
+                patch(chunk, exits, chunk.code.size());
+                end_loop(chunk, step, chunk.code.size());
+            } else if (auto forEach = dynamic_cast<ForEachStatement*>(node)) {
+                if (forEach->parallel) {
+                    program.bodies.emplace_back();
+                    Chunk& body = program.bodies.back();
+                    size_t enclosing_blocks = blocks;
+                    blocks = 0; // the body runs alone, in a frame of its own
+                    loop_body(forEach->block, body, "ForEachStatement");
+                    end_loop(body, body.code.size(), body.code.size()); // the parser lets no opreste through
+                    blocks = enclosing_blocks;
+                    Instruction ins{OpCode::PARALLEL_FOREACH, "ForEachStatement"};
+                    ins.node = forEach;
+                    ins.body = &body;
+                    emit(chunk, move(ins));
+                    return;
+                }
+                hoist_invariants(forEach, chunk, "ForEachStatement");
+                Instruction start{OpCode::FOREACH_START, "ForEachStatement"};
+                start.node = forEach;
+                start.reads_input = (forEach->sequence && reads_input(forEach->sequence)) ||
+                                    (forEach->start && (reads_input(forEach->start) || reads_input(forEach->end) ||
+                                                        (forEach->step && reads_input(forEach->step))));
+                emit(chunk, move(start));
+                Instruction next{OpCode::FOREACH_NEXT, "ForEachStatement"};
+                next.name = forEach->name;
+                size_t loop = emit(chunk, move(next));
+                loop_body(forEach->block, chunk, "ForEachStatement");
+                jump(chunk, OpCode::JUMP, nullptr, "ForEachStatement", loop);
+                chunk.code[loop].target = chunk.code.size();
+                end_loop(chunk, loop, chunk.code.size()); // opreste still drops the iterator
+                emit(chunk, Instruction{OpCode::FOREACH_END, "ForEachStatement"});
+            } else if (auto ifs = dynamic_cast<IfStatement*>(node)) {
+                vector<size_t> exits, skips;
+                branch(chunk, ifs->expr, false, skips, "IfStatement");
+                scoped_block(ifs->block, chunk, "IfStatement");
+                for (auto& elseIf : ifs->elseIfBranches) {
+                    exits.push_back(jump(chunk, OpCode::JUMP, nullptr, "IfStatement"));
+                    patch(chunk, skips, chunk.code.size());
+                    skips.clear();
+                    branch(chunk, elseIf.first, false, skips, "IfStatement");
+                    scoped_block(elseIf.second, chunk, "IfStatement");
+                }
+                if (!ifs->elseBlock.empty()) {
+                    exits.push_back(jump(chunk, OpCode::JUMP, nullptr, "IfStatement"));
+                    patch(chunk, skips, chunk.code.size());
+                    scoped_block(ifs->elseBlock, chunk, "IfStatement");
+                } else {
+                    patch(chunk, skips, chunk.code.size());
+                }
+                patch(chunk, exits, chunk.code.size());
+            } else if (auto expr = dynamic_cast<Expr*>(node)) {
+                if (user_function(expr) || dynamic_cast<AwaitExpr*>(expr)) {
+                    store(expr, "", false, dynamic_cast<AwaitExpr*>(expr) ? "AwaitExpr" : "FunctionCall", chunk);
+                } else if (auto print = printed(expr)) {
+                    Instruction ins{OpCode::PRINT_ARGS, "FunctionCall", expr};
+                    for (Expr* arg : print->args) ins.operands.push_back(operand(arg));
+                    emit(chunk, move(ins));
+                } else {
+                    Instruction ins{OpCode::EVAL, dynamic_cast<SpawnExpr*>(expr) ? "SpawnExpr" : "FunctionCall", expr};
+                    ins.reads_input = reads_input(expr);
+                    emit(chunk, move(ins));
+                }
+            }
+        }
+};
+
+static void inline_body(Inliner& inliner, FunctionDefinition* func) {
+    unordered_set<string> locals; // the parameters and whatever the body declares
+    for (ASTNode* param : func->args) locals.insert(static_cast<VariableDeclaration*>(param)->name);
+    visit_statements(func->block, [](Expr*&) {}, [&](const string& name) { locals.insert(name); });
+    inliner.block(func->block, locals);
+}
+
+void compile_program(vector<ASTNode*>& AST, const vector<ASTNode*>& functions, Program& program) {
+    MemScope scope(MemCategory::AST);
+    BlockScoper scoper(program.hidden);
+    scoper.chunk(AST);
+    for (ASTNode* node : functions) {
+        auto func = dynamic_cast<FunctionDefinition*>(node);
+        if (func && func->body < 0) scoper.chunk(func->block);
+    }
+    Inliner inliner(functions, program.hidden);
+    inliner.block(AST, {}); // the main program has no locals
+    for (ASTNode* node : functions) {
+        auto func = dynamic_cast<FunctionDefinition*>(node);
+        if (func && func->body >= 0) program.pending[func] = func;
+        else if (func) inline_body(inliner, func);
     }
-    //cout<<AST.size()<<" AST nodes found."<<endl;
 
-    auto full_interpretation_start = high_resolution_clock::now();
+    ExpressionVisitor find_spawns = [&](Expr*& expr) { program.tasks = program.tasks || spawns(expr); };
+    NameVisitor ignore = [](const string&) {};
+    visit_statements(AST, find_spawns, ignore);
+    for (ASTNode* node : functions) {
+        if (auto func = dynamic_cast<FunctionDefinition*>(node)) {
+            visit_statements(func->block, find_spawns, ignore);
+            program.tasks = program.tasks || func->starts_tasks;
+        }
+    }
+    ChunkCompiler compiler(program, functions, program.tasks);
+    compiler.block(AST, program.main);
+    for (ASTNode* node : functions) {
+        auto func = dynamic_cast<FunctionDefinition*>(node);
+        if (func && func->body < 0) compiler.block(func->block, program.functions[func]);
+    }
+}
+
+static void compile_pending(Program& program, const FunctionDefinition* func) {
+    /**
+     * @brief Parses and compiles a function body a lazy parse skipped, on its first call.
+     * @note A body with syntax errors stays pending, so every call of it fails, its errors only reported the first time.
+     */
+    MemScope scope(MemCategory::AST);
+    auto found = program.pending.find(func);
+    FunctionDefinition* definition = found->second;
+    if (definition->body < 0 || !program.parser->parse_body(definition)) {
+        throw runtime_error("Syntax errors in function " + func->name);
+    }
+    program.pending.erase(found);
+    const vector<ASTNode*>& functions = program.parser->functionDefinitions;
+    BlockScoper(program.hidden).chunk(definition->block);
+    Inliner inliner(functions, program.hidden);
+    inline_body(inliner, definition);
+    ChunkCompiler compiler(program, functions, program.tasks);
+    compiler.block(definition->block, program.functions[func]);
+}
+
+static const unsigned time_slice = 4096; // loop iterations a task may run while others are ready
+static const int max_native_depth = 2000; // nested calls from inside expressions, bounded by the native stack
+static const size_t max_frames = 1000000; // frames of one task
+
+static bool traced_statement(OpCode op) {
+    // jumps and iterator steps are traced as decisions, or not at all
+    return op != OpCode::JUMP && op != OpCode::JUMP_IF_FALSE && op != OpCode::JUMP_IF_TRUE && op != OpCode::COMPARE_JUMP_IF_FALSE &&
+           op != OpCode::COMPARE_JUMP_IF_TRUE && op != OpCode::FOREACH_NEXT && op != OpCode::FOREACH_END &&
+           op != OpCode::BLOCK_ENTER && op != OpCode::BLOCK_EXIT && op != OpCode::FORGET;
+}
+
+Executor::Executor(Context& ctx, Program& program, bool profiler) : ctx(ctx), program(program), profiler(profiler) {
+    previous = ctx.executor;
+    ctx.executor = this;
+}
+
+Executor::~Executor() {
+    ctx.executor = previous;
+}
 
-    for (ASTNode* node : AST) {
-        if (auto varDecl = dynamic_cast<VariableDeclaration*>(node)) {
-            auto start = high_resolution_clock::now();
-            //varDecl->value = simplify(varDecl->value);
-            Value value = varDecl->value->eval();
-            variables[varDecl->name] = value;
-            auto end = high_resolution_clock::now();
-            if (profiler) {
-                auto duration = duration_cast<microseconds>(end - start);
-                node_times["VariableDeclaration"] += duration;
-                node_counts["VariableDeclaration"]++;
-            }
-        } else if (auto print = dynamic_cast<PrintStatement*>(node)) {
-            auto start = high_resolution_clock::now();
-            //print->expr = simplify(print->expr);
-            cout<<variant_to_string(print->expr->eval());
-            auto end = high_resolution_clock::now();
-            if (profiler) {
-                auto duration = duration_cast<microseconds>(end - start);
-                node_times["PrintStatement"] += duration;
-                node_counts["PrintStatement"]++;
-            }
-        } else if (auto fc = dynamic_cast<FunctionCall*>(node)) {
-            auto start = high_resolution_clock::now();
-            //print->expr = simplify(print->expr);
-            vector<Value> args;
-            for (auto* arg : fc->args) {
-                args.push_back(arg->eval());
-            }
-            if (stdlib.find(fc->name)!=stdlib.end())
-                Value result = stdlib[fc->name](args);
-            else {
-                for (const auto& funcDef : functionDefinitions) {
-                    if (auto* func = dynamic_cast<FunctionDefinition*>(funcDef)) {
-                        if (func->name == fc->name) {
-                            // SCOPING, neaparat
-                            interpret(func->args, false, profiler, false);
-                            // assign args vector to func->args
-                            interpret(func->block, false, profiler, false);
-                            // return statement, mai sus in interpreter
-                            // delete la variabile din scope
-                        }
+void Executor::select(Task& task) {
+    /**
+     * @brief Makes the task the running one and points the context at the locals of its innermost frame.
+     */
+    current = &task;
+    ctx.locals = !task.frames.empty() && task.frames.back().function_frame ? &task.frames.back().locals : nullptr;
+}
+
+size_t Executor::live_tasks() const {
+    size_t live = 0;
+    for (const auto& task : tasks) {
+        if (task->state != Task::State::DONE) live++;
+    }
+    return live;
+}
+
+Value& Executor::declare(Task& task, const string& name) {
+    /**
+     * @brief Declares a variable in the innermost scope. Inside a running block, the block owns it: the variable (a hidden
+     * slot given by BlockScoper, which no other variable shares) is released when the block ends.
+     */
+    Frame& frame = task.frames.back();
+    if (!frame.blocks.empty()) {
+        auto first = frame.block_variables.begin() + frame.blocks.back();
+        if (find(first, frame.block_variables.end(), name) == frame.block_variables.end()) frame.block_variables.push_back(name);
+    }
+    return ctx.declare(name);
+}
+
+void Executor::release_block(Frame& frame) {
+    /**
+     * @brief Ends the innermost running block of the frame: its variables are freed.
+     */
+    auto& scope = ctx.locals ? *ctx.locals : ctx.variables;
+    while (frame.block_variables.size() > frame.blocks.back()) {
+        scope.erase(frame.block_variables.back());
+        frame.block_variables.pop_back();
+    }
+    frame.blocks.pop_back();
+}
+
+const Value& Executor::operand(const Operand& operand, Value& scratch) {
+    /**
+     * @brief The value a fused instruction reads: the variable itself, the constant, or the expression evaluated into scratch.
+     */
+    if (operand.variable) return ctx.lookup(*operand.variable);
+    if (operand.expr) return scratch = operand.expr->eval(ctx);
+    return operand.constant;
+}
+
+bool Executor::compare(const Instruction& ins) {
+    /**
+     * @brief Evaluates the comparison of a COMPARE_JUMP. Two ints are compared directly, anything else like BinaryExpr does.
+     */
+    Value left_scratch, right_scratch;
+    const Value& left = operand(ins.operands[0], left_scratch);
+    const Value& right = operand(ins.operands[1], right_scratch);
+    const int* l = get_if<int>(&left);
+    const int* r = get_if<int>(&right);
+    if (l && r) {
+        switch (ins.compare) {
+            case Compare::LT: return *l < *r;
+            case Compare::LE: return *l <= *r;
+            case Compare::GT: return *l > *r;
+            case Compare::GE: return *l >= *r;
+            case Compare::EQ: return *l == *r;
+            case Compare::NE: return *l != *r;
+        }
+    }
+    return condition_to_bool(BinaryExpr::apply(static_cast<const BinaryExpr*>(ins.expr)->op, left, right));
+}
+
+void Executor::store(Task& task, const string& name, bool declare, const Value& value) {
+    if (name.empty()) return;
+    (declare ? this->declare(task, name) : ctx.lookup(name)) = value;
+}
+
+void Executor::push_call(Task& task, const FunctionDefinition* func, const vector<Value>& args, const string& result_name, bool declare_result) {
+    /**
+     * @brief Pushes the frame of a user function call and binds its parameters.
+     * @note Missing arguments take the parameter defaults, evaluated in the callee's scope so they may use the earlier parameters.
+     */
+    if (args.size() > func->args.size()) {
+        throw runtime_error("Too many arguments for " + func->name);
+    }
+    if (task.frames.size() >= max_frames) {
+        throw runtime_error("Stack overflow in " + func->name);
+    }
+    loop_back_edge(ctx); // recursion loops without a backward jump
+    MemScope scope(MemCategory::FRAMES);
+    auto chunk = program.functions.find(func);
+    if (chunk == program.functions.end()) {
+        if (!program.pending.count(func)) throw runtime_error("Undefined function: " + func->name);
+        compile_pending(program, func);
+        chunk = program.functions.find(func);
+    }
+
+    if (ctx.tracer) ctx.tracer->record(TRACE_CALL, func, task.id);
+    task.frames.emplace_back();
+    Frame& frame = task.frames.back();
+    frame.chunk = &chunk->second;
+    frame.function_frame = true;
+    frame.result_name = result_name;
+    frame.declare_result = declare_result;
+    select(task);
+    for (size_t i = 0; i < func->args.size(); i++) {
+        auto* param = static_cast<VariableDeclaration*>(func->args[i]);
+        Value value = i < args.size() ? args[i] : param->value->eval(ctx);
+        frame.locals[param->name] = move(value);
+        select(task); // a default may have called another function
+    }
+}
+
+void Executor::return_from(Task& task, const Value& value) {
+    /**
+     * @brief Pops the innermost frame and hands its result to the caller, or finishes the task.
+     */
+    string result_name = move(task.frames.back().result_name);
+    bool declare_result = task.frames.back().declare_result;
+    if (ctx.tracer && task.frames.back().function_frame) ctx.tracer->record(TRACE_RETURN, task.frames.back().chunk, task.id, value);
+    task.frames.pop_back();
+    task.result = value;
+    if (task.frames.empty()) {
+        task.state = Task::State::DONE;
+        ctx.locals = nullptr;
+        return;
+    }
+    select(task);
+    if (ctx.tracer && !result_name.empty()) {
+        const Frame& caller = task.frames.back(); // its pc is just past the CALL that receives the value
+        ctx.tracer->record(TRACE_WRITE, &caller.chunk->code[caller.pc - 1], task.id, value);
+    }
+    store(task, result_name, declare_result, value);
+}
+
+bool Executor::back_edge() {
+    /**
+     * @brief Runs at every backward jump. Checks the deadline and ends the task's time slice if other tasks are waiting to run.
+     * @return true if the task should yield.
+     */
+    loop_back_edge(ctx);
+    if (++slice >= time_slice) {
+        slice = 0;
+        return live_tasks() > 1;
+    }
+    return false;
+}
+
+bool Executor::input_ready() const {
+    /**
+     * @brief Whether citeste would return without blocking.
+     * @note Only the process stdin can block; in-memory or socket streams given by an embedder are treated as always ready.
+     */
+    if (ctx.in != &cin) return true;
+    if (cin.rdbuf()->in_avail() > 0 || cin.eof()) return true;
+    pollfd fd{0, POLLIN, 0};
+    return poll(&fd, 1, 0) != 0;
+}
+
+void Executor::wait_for_input() const {
+    if (ctx.in != &cin) return;
+    pollfd fd{0, POLLIN, 0};
+    while (poll(&fd, 1, -1) < 0 && errno == EINTR) {}
+}
+
+bool Executor::can_resume(Task& task) const {
+    switch (task.state) {
+        case Task::State::READY: return true;
+        case Task::State::WAIT_TASK: return tasks[task.awaited]->state == Task::State::DONE;
+        case Task::State::WAIT_INPUT: return input_ready();
+        default: return false;
+    }
+}
+
+bool Executor::run_others(Task* self) {
+    /**
+     * @brief One round of the event loop: runs every task that can go on until it yields or finishes.
+     * @param self The task that asked, skipped like every task that is busy deeper in the native stack.
+     * @return false if no task could run.
+     */
+    bool progressed = false;
+    for (size_t i = 0; i < tasks.size(); i++) { // tasks may be spawned during the round
+        Task& task = *tasks[i];
+        if (&task == self || task.nested > 0 || task.state == Task::State::DONE || !can_resume(task)) continue;
+        task.state = Task::State::READY;
+        slice = 0;
+        execute(task, 0);
+        progressed = true;
+    }
+    return progressed;
+}
+
+static void stalled(const vector<unique_ptr<Task>>& tasks, const Executor& executor, void (Executor::*wait)() const) {
+    /**
+     * @brief Called when no task can run: blocks for input if a task needs it, otherwise every task waits for another one.
+     */
+    for (const auto& task : tasks) {
+        if (task->state == Task::State::WAIT_INPUT) {
+            (executor.*wait)();
+            return;
+        }
+    }
+    throw runtime_error("Deadlock: every task is waiting for another task");
+}
+
+void Executor::drive(Task& task, size_t stop_depth) {
+    /**
+     * @brief Runs the task until its stack is back to stop_depth frames, running the other tasks whenever it yields.
+     */
+    while (execute(task, stop_depth) == Status::YIELDED) {
+        if (task.state == Task::State::READY) run_others(&task); // end of a time slice
+        while (!can_resume(task)) {
+            if (!run_others(&task)) stalled(tasks, *this, &Executor::wait_for_input);
+        }
+        task.state = Task::State::READY;
+    }
+}
+
+void Executor::run() {
+    /**
+     * @brief The event loop: runs the main program as task 0 and round-robins over the tasks until all of them are done.
+     */
+    tasks.clear();
+    tasks.push_back(make_unique<Task>());
+    tasks[0]->id = 0;
+    tasks[0]->frames.emplace_back();
+    tasks[0]->frames.back().chunk = &program.main;
+
+    while (live_tasks() > 0) {
+        if (!run_others(nullptr)) stalled(tasks, *this, &Executor::wait_for_input);
+    }
+    current = nullptr;
+    ctx.locals = nullptr;
+}
+
+void Executor::run_body(const Chunk& body) {
+    /**
+     * @brief Runs a chunk once on the globals of the context, in a private task that never yields.
+     */
+    if (tasks.empty()) {
+        tasks.push_back(make_unique<Task>());
+        tasks[0]->id = 0;
+    }
+    Task& task = *tasks[0];
+    task.state = Task::State::READY;
+    task.frames.emplace_back();
+    task.frames.back().chunk = &body;
+    execute(task, 0);
+}
+
+Value Executor::call(const FunctionDefinition* func, const vector<Value>& args) {
+    /**
+     * @brief Calls a user function from inside an expression and returns its result.
+     * @note The call runs on the native stack; if it waits, the other tasks run in place until it can continue.
+     */
+    Task& task = *current;
+    if (task.nested >= max_native_depth) {
+        throw runtime_error("Stack overflow in " + func->name);
+    }
+    auto* locals = ctx.locals;
+    size_t depth = task.frames.size();
+    task.nested++;
+    push_call(task, func, args, "", false);
+    drive(task, depth);
+    task.nested--;
+    current = &task;
+    ctx.locals = locals;
+    return task.result;
+}
+
+int Executor::spawn(const FunctionDefinition* func, const vector<Value>& args) {
+    /**
+     * @brief Creates a task running the function; it gets its first turn when the running task yields.
+     */
+    Task* caller = current;
+    auto* locals = ctx.locals;
+    tasks.push_back(make_unique<Task>());
+    Task& task = *tasks.back();
+    task.id = tasks.size() - 1;
+    push_call(task, func, args, "", false);
+    current = caller;
+    ctx.locals = locals;
+    return task.id;
+}
+
+Value Executor::await(int id) {
+    /**
+     * @brief Waits for a task from inside an expression, running the other tasks in place until it is done.
+     */
+    if (id < 0 || id >= static_cast<int>(tasks.size())) {
+        throw runtime_error("asteapta expects a task");
+    }
+    Task& self = *current;
+    Task& target = *tasks[id];
+    if (&target == &self) {
+        throw runtime_error("A task cannot wait for itself");
+    }
+    auto* locals = ctx.locals;
+    self.nested++;
+    while (target.state != Task::State::DONE) {
+        if (!run_others(&self)) stalled(tasks, *this, &Executor::wait_for_input);
+    }
+    self.nested--;
+    current = &self;
+    ctx.locals = locals;
+    return target.result;
+}
+
+void Executor::run_parallel_foreach(Task& task, const Instruction& ins) {
+    /**
+     * @brief Runs the iterations of a checked `paralel` loop on the work-stealing pool.
+     * @note Every chunk of iterations gets a copy of the context (with the caller's locals flattened into its globals),
+     * so loop-local variables are private to it. Reduction targets start from their identity in every chunk and the partial
+     * results are combined in chunk order, which keeps string concatenation deterministic.
+     */
+    auto* loop = static_cast<ForEachStatement*>(ins.node);
+    long long start = range_bound(loop->start, ctx);
+    long long end = range_bound(loop->end, ctx);
+    long long step = loop->step ? range_bound(loop->step, ctx) : 1;
+    if (step == 0) {
+        throw runtime_error("interval step cannot be 0");
+    }
+    long long count = step > 0 ? (end - start + step - 1) / step : (start - end - step - 1) / -step;
+    if (count <= 0) return;
+
+    long long chunks = min<long long>(count, max(1u, ctx.threads) * 4ll); // signed like count, which splits between them
+    Context base = ctx;
+    base.locals = nullptr;
+    base.tracer = nullptr; // the ring buffer is not shared between threads
+    base.node_times.clear(); // profiler data is merged back once the loop is done
+    base.node_counts.clear();
+    if (ctx.locals) {
+        for (const auto& [name, value] : *ctx.locals) base.variables[name] = value;
+    }
+    for (const auto& [target, family] : loop->reductions) {
+        base.variables[target] = reduction_identity(ctx.lookup(target), family);
+    }
+    vector<Context> partial(chunks, base);
+
+    vector<exception_ptr> errors(chunks);
+    WorkStealingPool pool(ctx.threads);
+    pool.run(chunks, [&](size_t c) {
+        Context& local = partial[c];
+        BudgetScope budget(local.memory_budget);
+        try {
+            Executor worker(local, program, profiler);
+            long long first = count * static_cast<long long>(c) / chunks, end = count * static_cast<long long>(c + 1) / chunks;
+            for (long long k = first; k < end; k++) {
+                loop_back_edge(local);
+                local.variables[loop->name] = static_cast<int>(start + k * step);
+                worker.run_body(*ins.body);
+            }
+        } catch (...) {
+            errors[c] = current_exception();
+        }
+    });
+    for (const exception_ptr& error : errors) {
+        if (error) rethrow_exception(error);
+    }
+
+    for (const auto& [target, family] : loop->reductions) {
+        Value total = ctx.lookup(target);
+        for (Context& chunk : partial) {
+            total = BinaryExpr::apply(family, total, chunk.variables[target]);
+        }
+        ctx.lookup(target) = total;
+    }
+    // like after a sequential loop, the loop variables keep the values of the last iteration
+    for (const string& name : loop->locals) {
+        auto it = partial.back().variables.find(name);
+        if (it != partial.back().variables.end()) declare(task, name) = it->second;
+    }
+    for (Context& chunk : partial) {
+        ctx.operations += chunk.operations - base.operations;
+        for (const auto& [node_type, time] : chunk.node_times) {
+            ctx.node_times[node_type] += time;
+            ctx.node_counts[node_type] += chunk.node_counts[node_type];
+        }
+    }
+}
+
+Executor::Status Executor::execute(Task& task, size_t stop_depth) {
+    /**
+     * @brief The frame machine: executes the task's instructions until its stack shrinks to stop_depth frames or it yields.
+     */
+    MemScope scope(MemCategory::VALUES);
+    select(task);
+    while (task.frames.size() > stop_depth) {
+        Frame& frame = task.frames.back();
+        if (frame.pc >= frame.chunk->code.size()) { // falling off the end of a chunk returns 0
+            return_from(task, 0);
+            continue;
+        }
+        const Instruction& ins = frame.chunk->code[frame.pc];
+        if (ins.reads_input && !input_ready() && live_tasks() > 1) {
+            task.state = Task::State::WAIT_INPUT;
+            return Status::YIELDED;
+        }
+
+        memory_line(ins.line);
+        ctx.operations++;
+        if (ctx.tracer && traced_statement(ins.op)) ctx.tracer->record(TRACE_STATEMENT, &ins, task.id);
+        auto start = profiler ? high_resolution_clock::now() : high_resolution_clock::time_point();
+        size_t pc = frame.pc++;
+        bool jumped_back = false;
+        switch (ins.op) {
+            case OpCode::DECLARE: {
+                Value value = ins.expr->eval(ctx);
+                if (ctx.tracer) ctx.tracer->record(TRACE_WRITE, &ins, task.id, value);
+                declare(task, ins.name) = move(value);
+                break;
+            }
+            case OpCode::ASSIGN: {
+                Value value = ins.expr->eval(ctx);
+                if (ctx.tracer) ctx.tracer->record(TRACE_WRITE, &ins, task.id, value);
+                ctx.lookup(ins.name) = move(value);
+                break;
+            }
+            case OpCode::UPDATE: {
+                Value scratch;
+                const Value& value = operand(ins.operands[0], scratch);
+                Value& target = ctx.lookup(ins.name);
+                UpdateStatement::apply(target, ins.update, value); // appending in place keeps repeated appends linear
+                if (ctx.tracer) ctx.tracer->record(TRACE_WRITE, &ins, task.id, target);
+                break;
+            }
+            case OpCode::INPUT: {
+                MemScope strings(MemCategory::STRINGS);
+                string inputValue;
+                getline(*ctx.in, inputValue);
+                if (ctx.tracer) ctx.tracer->record(TRACE_WRITE, &ins, task.id, inputValue);
+                ctx.lookup(ins.name) = inputValue;
+                break;
+            }
+            case OpCode::PRINT: {
+                Value value = ins.expr->eval(ctx);
+                MemScope strings(MemCategory::STRINGS);
+                *ctx.out << variant_to_string(value);
+                break;
+            }
+            case OpCode::PRINT_ARGS:
+                for (const Operand& arg : ins.operands) {
+                    print_value(*ctx.out, arg.variable ? ctx.lookup(*arg.variable) : arg.constant);
+                }
+                break;
+            case OpCode::EVAL:
+                ins.expr->eval(ctx);
+                break;
+            case OpCode::CALL: {
+                vector<Value> args;
+                for (Expr* arg : ins.args) {
+                    args.push_back(arg->eval(ctx));
+                }
+                push_call(task, ins.function, args, ins.name, ins.declare);
+                break;
+            }
+            case OpCode::RETURN:
+                return_from(task, ins.expr ? ins.expr->eval(ctx) : Value(0));
+                break;
+            case OpCode::AWAIT: {
+                int id = task.awaited; // set when the task is resumed after waiting here
+                task.awaited = -1;
+                if (id < 0) {
+                    Value handle = ins.expr->eval(ctx);
+                    if (!holds_alternative<int>(handle) || get<int>(handle) < 0 || get<int>(handle) >= static_cast<int>(tasks.size())) {
+                        throw runtime_error("asteapta expects a task");
                     }
+                    id = get<int>(handle);
+                }
+                if (tasks[id].get() == &task) {
+                    throw runtime_error("A task cannot wait for itself");
                 }
+                if (tasks[id]->state != Task::State::DONE) {
+                    frame.pc--;
+                    task.awaited = id;
+                    task.state = Task::State::WAIT_TASK;
+                    return Status::YIELDED;
+                }
+                if (ctx.tracer && !ins.name.empty()) ctx.tracer->record(TRACE_WRITE, &ins, task.id, tasks[id]->result);
+                store(task, ins.name, ins.declare, tasks[id]->result);
+                break;
             }
-                //cout << "Function call result: " << variant_to_string(result) << endl;  // Debug
-            auto end = high_resolution_clock::now();
-            if (profiler) {
-                auto duration = duration_cast<microseconds>(end - start);
-                node_times["FunctionCall"] += duration;
-                node_counts["FunctionCall"]++;
-            }
-        } else if (auto inp = dynamic_cast<InputStatement*>(node)) {
-            auto start = high_resolution_clock::now();
-            string inputValue;
-            getline(cin, inputValue);
-            Value inputValueVariant = inputValue;
-
-            variables[variant_to_string(inp->name)] = inputValueVariant;
-            auto end = high_resolution_clock::now();
-            if (profiler) {
-                auto duration = duration_cast<microseconds>(end - start);
-                node_times["InputStatement"] += duration;
-                node_counts["InputStatement"]++;
-            }
-        } else if (auto assign = dynamic_cast<AssignStatement*>(node)) {
-            auto start = high_resolution_clock::now();
-            //assign->expr = simplify(assign->expr);
-            variables[assign->name] = assign->expr->eval();
-            //cout << "Assign: " << assign->name << " = " << variant_to_string(variables[assign->name]) << endl;  // Debug
-            auto end = high_resolution_clock::now();
-            if (profiler) {
-                auto duration = duration_cast<microseconds>(end - start);
-                node_times["AssignStatement"] += duration;
-                node_counts["AssignStatement"]++;
-            }
-        } else if (auto whileStmt = dynamic_cast<WhileStatement*>(node)) {
-            auto start = high_resolution_clock::now();
-            auto duration_block = duration_cast<microseconds>(start - start);
-            while (true) {
-                Value conditionValue = whileStmt->expr->eval();
-
-                if (!condition_to_bool(conditionValue)) break;
-
-                auto block_start = high_resolution_clock::now();
-                interpret(whileStmt->block, false, profiler, false);
-                auto block_end = high_resolution_clock::now();
-                duration_block += duration_cast<microseconds>(block_end - block_start);
-            }
-            auto end = high_resolution_clock::now();
-            if (profiler) {
-                auto duration = duration_cast<microseconds>(end - start - duration_block);
-                node_times["WhileStatement"] += duration;
-                node_counts["WhileStatement"]++;
-            }
-        } else if (auto doWhileStmt = dynamic_cast<DoWhileStatement*>(node)) {
-            auto start = high_resolution_clock::now();
-            auto duration_block = duration_cast<microseconds>(start - start);
-            
-            do {
-                auto block_start = high_resolution_clock::now();
-                interpret(doWhileStmt->block, false, profiler, false);
-                auto block_end = high_resolution_clock::now();
-                duration_block += duration_cast<microseconds>(block_end - block_start);
-
-                Value conditionValue = doWhileStmt->expr->eval();
-
-                if (!condition_to_bool(conditionValue)) break;
-            } while (true);
-            auto end = high_resolution_clock::now();
-            if (profiler) {
-                auto duration = duration_cast<microseconds>(end - start - duration_block);
-                node_times["DoWhileStatement"] += duration;
-                node_counts["DoWhileStatement"]++;
-            }
-        } else if (auto doUntilStmt = dynamic_cast<DoUntilStatement*>(node)) {
-            auto start = high_resolution_clock::now();
-            auto duration_block = duration_cast<microseconds>(start - start);
-            
-            do {
-                auto block_start = high_resolution_clock::now();
-                interpret(doUntilStmt->block, false, profiler, false);
-                auto block_end = high_resolution_clock::now();
-                duration_block += duration_cast<microseconds>(block_end - block_start);
-
-                Value conditionValue = doUntilStmt->expr->eval();
-
-                if (condition_to_bool(conditionValue)) break;
-            } while (true);
-            auto end = high_resolution_clock::now();
-            if (profiler) {
-                auto duration = duration_cast<microseconds>(end - start - duration_block);
-                node_times["DoUntilStatement"] += duration;
-                node_counts["DoUntilStatement"]++;
-            }
-        } else if (auto forStmt = dynamic_cast<ForStatement*>(node)) {
-            auto start = high_resolution_clock::now();
-            auto duration_block = duration_cast<microseconds>(start - start);
-            interpret({forStmt->init_block}, false, profiler, false);
-            Value conditionValue = forStmt->expr->eval();
-            while (condition_to_bool(conditionValue)) {
-                auto block_start = high_resolution_clock::now();
-                interpret(forStmt->block, false, profiler, false);
-                interpret({forStmt->assign_block}, false, profiler, false);
-                auto block_end = high_resolution_clock::now();
-                duration_block += duration_cast<microseconds>(block_end - block_start);
-                conditionValue = forStmt->expr->eval(); // re-evaluate condition after each iteration
-            }
-            auto end = high_resolution_clock::now();
-            if (profiler) {
-                auto duration = duration_cast<microseconds>(end - start - duration_block);
-                node_times["ForStatement"] += duration;
-                node_counts["ForStatement"]++;
-            }
-        } else if (auto ifs = dynamic_cast<IfStatement*>(node)) {
-            auto start = high_resolution_clock::now();
-            //ifs->expr = simplify(ifs->expr);
-            Value conditionValue = ifs->expr->eval();
-            if (condition_to_bool(conditionValue)) {
-                interpret(ifs->block,false, profiler, false);
-            } else {
-                bool run_first_branch=false;
-                for (auto& elseIfBranch : ifs->elseIfBranches) {
-                    //elseIfBranch.first = simplify(elseIfBranch.first);
-                    Value elseIfConditionValue = elseIfBranch.first->eval();
-                    if (condition_to_bool(elseIfConditionValue) && !run_first_branch) {
-                        interpret(elseIfBranch.second,false, profiler, false);
-                        run_first_branch = true;
-                        break;
+            case OpCode::JUMP:
+                frame.pc = ins.target;
+                jumped_back = ins.target <= pc;
+                break;
+            case OpCode::JUMP_IF_FALSE:
+            case OpCode::JUMP_IF_TRUE:
+            case OpCode::COMPARE_JUMP_IF_FALSE:
+            case OpCode::COMPARE_JUMP_IF_TRUE: {
+                bool fused = ins.op == OpCode::COMPARE_JUMP_IF_FALSE || ins.op == OpCode::COMPARE_JUMP_IF_TRUE;
+                bool condition = fused ? compare(ins) : condition_to_bool(ins.expr->eval(ctx));
+                bool jump = condition == (ins.op == OpCode::JUMP_IF_TRUE || ins.op == OpCode::COMPARE_JUMP_IF_TRUE);
+                if (jump) {
+                    frame.pc = ins.target;
+                    jumped_back = ins.target <= pc;
+                }
+                // a forward jump skips the branch or leaves the loop, a backward one repeats the loop
+                if (ctx.tracer) ctx.tracer->decision(&ins, task.id, jump == (ins.target <= pc));
+                break;
+            }
+            case OpCode::FOREACH_START: {
+                auto* loop = static_cast<ForEachStatement*>(ins.node);
+                LoopIterator it;
+                if (loop->sequence) {
+                    Value sequence = loop->sequence->eval(ctx);
+                    if (!holds_alternative<string>(sequence)) {
+                        throw runtime_error("pentru fiecare expects a string or an interval");
+                    }
+                    it.chars = get<string>(sequence);
+                    it.over_string = true;
+                    it.remaining = it.chars.size();
+                } else {
+                    long long first = range_bound(loop->start, ctx);
+                    long long end = range_bound(loop->end, ctx);
+                    it.step = loop->step ? range_bound(loop->step, ctx) : 1;
+                    if (it.step == 0) {
+                        throw runtime_error("interval step cannot be 0");
                     }
+                    it.next = first;
+                    it.remaining = max(0ll, it.step > 0 ? (end - first + it.step - 1) / it.step : (first - end - it.step - 1) / -it.step);
+                }
+                frame.iterators.push_back(move(it));
+                break;
+            }
+            case OpCode::FOREACH_NEXT: {
+                LoopIterator& it = frame.iterators.back();
+                if (ctx.tracer) ctx.tracer->decision(&ins, task.id, it.remaining > 0);
+                if (it.remaining == 0) {
+                    frame.pc = ins.target;
+                    break;
                 }
-                if (!ifs->elseBlock.empty() && !run_first_branch) {
-                    interpret(ifs->elseBlock,false, profiler, false);
+                it.remaining--;
+                Value& variable = declare(task, ins.name);
+                if (it.over_string) {
+                    variable = string(1, it.chars[it.next++]);
+                } else {
+                    variable = static_cast<int>(it.next);
+                    it.next += it.step;
                 }
+                if (ctx.tracer) ctx.tracer->record(TRACE_WRITE, &ins, task.id, variable);
+                break;
             }
-            auto end = high_resolution_clock::now();
-            if (profiler) {
-                auto duration = duration_cast<microseconds>(end - start);
-                node_times["IfStatement"] += duration;
-                node_counts["IfStatement"]++;
+            case OpCode::FOREACH_END:
+                frame.iterators.pop_back();
+                break;
+            case OpCode::PARALLEL_FOREACH:
+                run_parallel_foreach(task, ins);
+                break;
+            case OpCode::BLOCK_ENTER:
+                frame.blocks.push_back(frame.block_variables.size());
+                break;
+            case OpCode::BLOCK_EXIT:
+                release_block(frame);
+                break;
+            case OpCode::SWITCH:
+                frame.pc = ins.table->find(ins.expr->eval(ctx));
+                break;
+            case OpCode::FORGET: {
+                auto& scope = ctx.locals ? *ctx.locals : ctx.variables;
+                for (Expr* hoisted : ins.args) scope.erase(static_cast<InvariantExpr*>(hoisted)->slot);
+                break;
             }
         }
+        if (profiler) {
+            ctx.node_times[ins.node_type] += duration_cast<microseconds>(high_resolution_clock::now() - start);
+            ctx.node_counts[ins.node_type]++;
+        }
+        if (jumped_back && back_edge()) { // every loop iteration ends with a backward jump
+            return Status::YIELDED;
+        }
+    }
+    return Status::DONE;
+}
+
+Value call_user_function(Context& ctx, const FunctionDefinition* func, const vector<Value>& args) {
+    if (!ctx.executor) {
+        throw runtime_error("User functions can only be called while a program runs");
     }
+    return ctx.executor->call(func, args);
+}
+
+int spawn_task(Context& ctx, const FunctionDefinition* func, const vector<Value>& args) {
+    if (!ctx.executor) {
+        throw runtime_error("Tasks can only be started while a program runs");
+    }
+    return ctx.executor->spawn(func, args);
+}
+
+Value await_task(Context& ctx, int id) {
+    if (!ctx.executor) {
+        throw runtime_error("Tasks can only be awaited while a program runs");
+    }
+    return ctx.executor->await(id);
+}
 
-	//cout<<endl;
+Interpreter::Interpreter(ostream& out, istream& in, ostream& err) {
+    ctx.out = &out;
+    ctx.in = &in;
+    ctx.err = &err;
+    ctx.functions = &parser.functionDefinitions;
+    parser.err = &err;
+}
 
-    //for (const auto& var : variables) {
-    //    cout << "Variable: " << var.first << " = " << variant_to_string(var.second) << endl;
-    //}
+bool Interpreter::load_file(const string& fn) {
+    /**
+     * @brief Lexes and parses a source file, replacing any previously loaded program.
+     * @return false if the file could not be opened or has syntax errors (they are written to the error stream).
+     */
+    ifstream file(fn);
+    if (!file) {
+        *ctx.err << "File not found: " << fn << endl;
+        return false;
+    }
+    vector<Span> spans;
+    auto tokens = lexer(file, &spans);
+    return load_tokens(tokens, spans);
+}
 
+bool Interpreter::load_source(const string& source) {
+    /**
+     * @brief Lexes and parses source code held in memory, replacing any previously loaded program.
+     */
+    istringstream source_stream(source);
+    vector<Span> spans;
+    auto tokens = lexer(source_stream, &spans);
+    return load_tokens(tokens, spans);
+}
+
+bool Interpreter::load_tokens(const pair<vector<pair<string, string>>, vector<int>>& tokens, const vector<Span>& spans) {
+    /**
+     * @brief Parses the output of the lexer, replacing any previously loaded program.
+     * @param spans The token columns from the lexer, used by the syntax errors; may be empty.
+     * @return false if there are syntax errors; the loaded program is then empty, so a run() does nothing.
+     */
+    parser.reset();
+    parser.lazy_functions = lazy_functions;
+    program = parser.parse(tokens.first, tokens.second, spans);
+    bool valid = none_of(parser.errors.begin(), parser.errors.end(), [](const SyntaxError& e) { return !e.warning; });
+    if (!valid) program.clear(); // the statements that failed to parse are missing, running the rest would do something else
+    compiled = Program();
+    compiled.parser = &parser;
+    compile_program(program, valid ? parser.functionDefinitions : vector<ASTNode*>(), compiled);
+    return valid;
+}
+
+void Interpreter::run(bool fprint_ast, bool profiler, bool print_pdata) {
+    /**
+     * @brief Runs the loaded program. Variables left by a previous run are kept, call reset() to start clean.
+     * @note The limits are applied per run: the timeout starts and the operation and memory counters are reset here.
+     */
+    if (fprint_ast){
+        cout << "AST:" << endl;
+        print_ast(program);
+    }
+
+    ctx.operations = 0;
+    ctx.max_operations = limits.max_operations;
+    if (limits.timeout_ms > 0) ctx.deadline = steady_clock::now() + milliseconds(limits.timeout_ms);
+    MemoryBudget budget(limits.max_memory);
+    BudgetScope budget_scope(limits.max_memory > 0 ? &budget : nullptr);
+    ctx.memory_budget = limits.max_memory > 0 ? &budget : nullptr;
+
+    auto full_interpretation_start = high_resolution_clock::now();
+    try {
+        Executor executor(ctx, compiled, profiler);
+        executor.run();
+    } catch (...) {
+        ctx.memory_budget = nullptr;
+        throw;
+    }
+    ctx.memory_budget = nullptr;
     auto full_interpretation_end = high_resolution_clock::now();
+
     if (profiler && print_pdata) {
-        cout<<endl;
+        *ctx.out<<endl;
         auto duration = duration_cast<microseconds>(full_interpretation_end - full_interpretation_start);
-        //auto durations = duration_cast<seconds>(full_interpretation_end - full_interpretation_start);
         double seconds = duration.count() / 1000000.0;
-        cout << "Full interpretation took: " << duration.count() << " micros " << seconds << " s" << endl;
-        cout << "Node execution times:" << endl;
-        for (const auto& [node_type, time] : node_times) {
-            cout << node_type << ": " << time.count() << " micros, executed " << node_counts[node_type] << " times" << endl;
-            cout << "Average time: " << (time.count() / (node_counts[node_type] ? node_counts[node_type] : 1)) << " micros" << endl;
+        *ctx.out << "Full interpretation took: " << duration.count() << " micros " << seconds << " s" << endl;
+        *ctx.out << "Node execution times:" << endl;
+        for (const auto& [node_type, time] : ctx.node_times) {
+            *ctx.out << node_type << ": " << time.count() << " micros, executed " << ctx.node_counts[node_type] << " times" << endl;
+            *ctx.out << "Average time: " << (time.count() / (ctx.node_counts[node_type] ? ctx.node_counts[node_type] : 1)) << " micros" << endl;
         }
     }
+    ctx.out->flush();
+}
+
+void Interpreter::reset() {
+    /**
+     * @brief Forgets all variables and profiler data, keeping the loaded program.
+     */
+    ctx.variables.clear();
+    ctx.node_times.clear();
+    ctx.node_counts.clear();
+}
+
+Value Interpreter::get_variable(const string& name) const {
+    auto it = ctx.variables.find(name);
+    if (it == ctx.variables.end()) {
+        throw runtime_error("Undefined variable: " + name);
+    }
+    return it->second;
+}
+
+void Interpreter::set_variable(const string& name, const Value& value) {
+    ctx.variables[name] = value;
 }
@@ -1,3 +1,245 @@
+/**
+ * @file interpreter.h
+ * @brief Header file for the interpreter component of the Roscript interpreter.
+ * This file contains the compiled form of a program (chunks of instructions), the frame-based executor with its task scheduler,
+ * and the Interpreter class, the embedding API that ties the lexer, the parser and the runtime context together.
+ * @author Rares-Cosma & Vlad-Oprea
+ * @date 2025-06-24
+ */
+
+#pragma once
 #include "parser.h"
+#include <deque>
+#include <memory>
+
+/**
+ * @enum OpCode
+ * @brief The operations of the compiled statements. Expressions stay AST trees, only control flow is flattened into jumps.
+ */
+enum class OpCode {
+	DECLARE, // declare `name` in the innermost scope with the value of `expr`
+	ASSIGN, // store the value of `expr` into `name`
+	UPDATE, // `name = name <update> operands[0]` in place: numbers change inside the variable, a string grows
+	INPUT, // read a line into `name`
+	PRINT, // print the value of `expr`
+	PRINT_ARGS, // print `operands` like afiseaza does, without building its argument list
+	EVAL, // evaluate `expr` for its side effects
+	CALL, // call the user function `function` with `args`, the result goes into `name` (if any)
+	RETURN, // return the value of `expr` (0 if none) from the running call
+	AWAIT, // wait for the task whose id is the value of `expr`, the result goes into `name` (if any)
+	JUMP, // continue at `target`
+	JUMP_IF_FALSE, // continue at `target` if `expr` is false
+	JUMP_IF_TRUE, // continue at `target` if `expr` is true
+	COMPARE_JUMP_IF_FALSE, // continue at `target` unless `operands[0] <compare> operands[1]`; `expr` is the comparison
+	COMPARE_JUMP_IF_TRUE, // continue at `target` if `operands[0] <compare> operands[1]`
+	FOREACH_START, // evaluate the string or interval of the ForEachStatement `node` and push an iterator
+	FOREACH_NEXT, // store the next value into `name`, or continue at `target` once the iterator is exhausted
+	FOREACH_END, // pop the iterator
+	PARALLEL_FOREACH, // run the checked `paralel` loop `node`, whose block is compiled into `body`
+	BLOCK_ENTER, // start a block that declares variables
+	BLOCK_EXIT, // end the innermost block: release the variables it declared
+	SWITCH, // continue at the case of `table` matching the value of `expr`
+	FORGET, // drop the values cached by the InvariantExprs in `args`: a loop is entered, they are evaluated again
+};
+
+struct Chunk;
+
+/**
+ * @struct Operand
+ * @brief What a fused instruction reads: a variable in place (no copy), a literal's value, or else an expression to evaluate.
+ */
+struct Operand {
+	const string* variable = nullptr; // the name of the variable, owned by the AST
+	Expr* expr = nullptr;
+	Value constant;
+};
+
+enum class Compare : char { LT, LE, GT, GE, EQ, NE };
+
+/**
+ * @struct SwitchTable
+ * @brief Where an `alege` continues for each label. Int labels close enough together index a vector, the others are hashed.
+ */
+struct SwitchTable {
+	int first = 0; // the smallest int label when `dense` is used
+	vector<size_t> dense; // targets by int label - first, `otherwise` in the gaps; empty if the int labels are sparse
+	unordered_map<int, size_t> ints; // targets of sparse int labels
+	unordered_map<string, size_t> strings;
+	size_t otherwise = 0; // the altfel block, or the end of the statement
+
+	void build(const vector<pair<Value, size_t>>& labels);
+	size_t find(const Value& value) const;
+};
+
+/**
+ * @struct Instruction
+ * @brief One compiled statement or control transfer.
+ */
+struct Instruction {
+	OpCode op;
+	const char* node_type; // name of the AST node the instruction comes from, used by the profiler
+	Expr* expr = nullptr; // owned by the AST
+	string name;
+	bool declare = false; // CALL and AWAIT: declare `name` instead of assigning it
+	char update = 0; // UPDATE: the operator, '+', '-', '*' or '/'
+	const FunctionDefinition* function = nullptr;
+	vector<Expr*> args; // CALL: the arguments; FORGET: the hoisted expressions
+	ASTNode* node = nullptr;
+	const Chunk* body = nullptr;
+	const SwitchTable* table = nullptr; // SWITCH: the targets of the cases
+	vector<Operand> operands; // UPDATE, PRINT_ARGS and the COMPARE_JUMPs: what they read, in order
+	Compare compare = Compare::EQ; // COMPARE_JUMP_IF_FALSE and COMPARE_JUMP_IF_TRUE
+	size_t target = 0;
+	bool reads_input = false; // the instruction may block on citeste, so a task yields until input is ready
+	int line = 0; // source line of the statement, for the memory profiler
+
+	Instruction(OpCode op, const char* node_type, Expr* expr = nullptr) : op(op), node_type(node_type), expr(expr) {}
+};
+
+/**
+ * @struct Chunk
+ * @brief The compiled code of the main program, of a function or of a `paralel` loop body.
+ */
+struct Chunk {
+	vector<Instruction> code;
+};
+
+/**
+ * @struct Program
+ * @brief Every chunk compiled from one AST.
+ */
+struct Program {
+	Chunk main;
+	unordered_map<const FunctionDefinition*, Chunk> functions;
+	deque<Chunk> bodies; // bodies of `paralel` loops, a deque so the instructions can point to them
+	deque<SwitchTable> switches; // jump tables of `alege` statements, a deque for the same reason
+	unordered_map<const FunctionDefinition*, FunctionDefinition*> pending; // bodies a lazy parse skipped, compiled on the first call
+	Parser* parser = nullptr; // the parser that skipped them
+	bool tasks = false; // the program starts tasks
+	size_t hidden = 0; // hidden slots made so far, numbering them
+};
+
+/**
+ * @brief Compiles the AST of a program, its functions included.
+ * @param AST The top level statements. Like the function bodies, they are optimized in place: calls of small functions
+ * are inlined and the expressions that do not change in a loop are hoisted.
+ * @param functions The FunctionDefinition nodes known to the parser.
+ * @param program The program to fill.
+ * @note The bodies a lazy parse skipped are only registered in program.pending: the first call of one compiles it.
+ */
+void compile_program(vector<ASTNode*>& AST, const vector<ASTNode*>& functions, Program& program);
+
+/**
+ * @struct LoopIterator
+ * @brief The state of a running `pentru fiecare` loop.
+ */
+struct LoopIterator {
+	long long next = 0, step = 1, remaining = 0;
+	string chars; // the iterated string, empty for an interval
+	bool over_string = false;
+};
+
+/**
+ * @struct Frame
+ * @brief One activation of a chunk: the main program or a user function call.
+ */
+struct Frame {
+	const Chunk* chunk;
+	size_t pc = 0;
+	bool function_frame = false; // function calls have their own locals, the main program uses the globals
+	unordered_map<string, Value> locals;
+	vector<LoopIterator> iterators;
+	vector<string> block_variables; // the slots declared by the running blocks, innermost block last
+	vector<size_t> blocks; // for every running block, where its variables start in block_variables
+	string result_name; // where the caller wants the returned value, empty to drop it
+	bool declare_result = false;
+};
+
+/**
+ * @struct Task
+ * @brief A stackless coroutine: its whole call stack is the deque of frames, so it can be suspended between any two instructions.
+ */
+struct Task {
+	enum class State { READY, WAIT_TASK, WAIT_INPUT, DONE };
+
+	int id;
+	deque<Frame> frames; // a deque so the locals of a frame never move while it runs
+	State state = State::READY;
+	int awaited = -1; // the task this one waits for
+	Value result = 0; // the value returned by the task's function
+	int nested = 0; // native calls (user functions called from inside expressions) running on this task
+};
+
+/**
+ * @class Executor
+ * @brief Runs a compiled program: the frame machine executing the instructions and the event loop scheduling the tasks.
+ * @note Tasks switch at `asteapta`, while waiting for input, and after a time slice of loop iterations, so no task needs an OS thread.
+ */
+class Executor {
+	public:
+		Executor(Context& ctx, Program& program, bool profiler = false);
+		~Executor();
+
+		void run(); // runs the main chunk and every spawned task to completion
+		void run_body(const Chunk& body); // runs a chunk that never yields, e.g. a `paralel` loop body
+
+		Value call(const FunctionDefinition* func, const vector<Value>& args);
+		int spawn(const FunctionDefinition* func, const vector<Value>& args);
+		Value await(int id);
+
+	private:
+		enum class Status { DONE, YIELDED };
+
+		Context& ctx;
+		Program& program;
+		bool profiler;
+		Executor* previous; // the executor the context had before this one
+		vector<unique_ptr<Task>> tasks; // indexed by task id, task 0 is the main program
+		Task* current = nullptr;
+		unsigned slice = 0; // loop iterations since the running task was scheduled
+
+		Status execute(Task& task, size_t stop_depth);
+		void push_call(Task& task, const FunctionDefinition* func, const vector<Value>& args, const string& result_name, bool declare_result);
+		void return_from(Task& task, const Value& value);
+		Value& declare(Task& task, const string& name);
+		void release_block(Frame& frame);
+		void store(Task& task, const string& name, bool declare, const Value& value);
+		const Value& operand(const Operand& operand, Value& scratch);
+		bool compare(const Instruction& ins);
+		bool back_edge();
+		void run_parallel_foreach(Task& task, const Instruction& ins);
+		bool input_ready() const;
+		void wait_for_input() const;
+		bool can_resume(Task& task) const;
+		bool run_others(Task* self);
+		void drive(Task& task, size_t stop_depth);
+		void select(Task& task);
+		size_t live_tasks() const;
+};
+
+/**
+ * @class Interpreter
+ * @brief One independent Roscript program together with its runtime state.
+ * @note Interpreters share no state, so a host can run several of them in parallel threads.
+ * @details Typical use: load_file() or load_source(), optionally set_variable(), then run().
+ */
+class Interpreter {
+	public:
+		Context ctx; // runtime state: variables, streams and profiler data
+		Parser parser; // parser state, owns the AST
+		vector<ASTNode*> program; // the top level statements of the loaded script
+		Program compiled; // the compiled form of program
+		Limits limits; // applied to every run()
+		bool lazy_functions = false; // parse and compile the top level function bodies on their first call, not at load time
+
+		Interpreter(ostream& out = cout, istream& in = cin, ostream& err = cerr);
+
+		bool load_file(const string& fn);
+		bool load_source(const string& source);
+		bool load_tokens(const pair<vector<pair<string, string>>, vector<int>>& tokens, const vector<Span>& spans = {});
+		void run(bool fprint_ast = false, bool profiler = false, bool print_pdata = true);
+		void reset();
 
-void interpret(vector<ASTNode*> AST, bool fprint_ast, bool profiler, bool print_pdata);
\ No newline at end of file
+		Value get_variable(const string& name) const;
+		void set_variable(const string& name, const Value& value);
+};
@@ -10,9 +10,11 @@
  */
 #include "lexer.h"
 #include "commons.cpp"
+#include "memory.h"
 #include <fstream>
 #include <iostream>
 #include <vector>
+#include <sstream>
 
 using namespace std;
 
@@ -22,17 +24,18 @@ bool isnotsep(char letter) {
      * @param letter The character to check.
      * @return true if the character is not a separator, false otherwise.
      */
-    string sep = " =;+-*/(){}[],<>!%\n\r";
+    string sep = " =;+-*/(){}[],<>!%&|\n\r";
     return sep.find(letter) == string::npos;
 }
 
+const vector<string> keywords = {"var","daca","atunci","altfel","executa","cat","timp","pentru","pana","cand","fiecare","din","paralel","repeta","functie","returneaza","porneste","asteapta","opreste","continua","alege","caz","si","sau","nu"};
+
 bool iskeyword(const string& word) {
     /**
      * @brief Checks if a word is a keyword in the Roscript language.
      * @param word The word to check.
      * @return true if the word is a keyword, false otherwise.
      */
-    vector<string> keywords = {"var","daca","atunci","altfel","executa","cat","timp","pentru","pana","cand","fiecare","repeta","functie"};
     for (const string& kw : keywords) {
         if (word == kw) return true;
     }
@@ -40,113 +43,175 @@ bool iskeyword(const string& word) {
 }
 
 pair<vector<pair<string, string>>,vector<int>> lexer(string fn) {
-    vector<pair<string, string>> tokens;
-    ifstream file(fn); // opens the file with the source code
-    Type checker;
-
-    vector<int> tpl; // to store the number of tokens per line
-
     /**
      * @brief Lexical analyzer function that reads a source file and tokenizes its content.
      * @param fn The file name to read.
-     * @param tokens A vector to store the tokens found in the file.
-     * @param tpl A vector to store the number of tokens per line.
      * @return A pair containing the vector of tokens and the vector of token counts per line
      */
-
-    int ct=0; // counter representing the number of tokens on a line
+    ifstream file(fn); // opens the file with the source code
 
     if (!file) {
         cout << "File not found" << endl;
-        return {tokens, tpl};
+        return {};
     }
 
-    char current_char;
+    return lexer(file);
+}
+
+int lex_line(const string& line, LexState& state, vector<pair<string, string>>& tokens, vector<Span>* spans) {
+    /**
+     * @brief Tokenizes one line of source code.
+     * @param line The line, without its '\n'.
+     * @param state Whether the line starts inside a string literal, updated for the next line.
+     * @param tokens Where the tokens found are appended.
+     * @param spans If not null, where the columns of the tokens found are appended.
+     * @return The number of tokens appended, the count the line gets in tokens_per_line.
+     * @note A string literal spanning lines becomes one token on the line where it ends.
+     */
+    int ct = 0; // counter representing the number of tokens on the line
+    size_t i = 0;
     string keyword;
-    while (file.get(current_char)) { // read character by character until EOF
-        if (current_char == '\r') {
-            continue;
-        }
-        if (current_char == '\n'){ // send the ct to the vector and reset it
-            tpl.push_back(ct);
-            ct=0;
-            continue;
-        }
+    size_t keyword_start = 0, string_start = 0; // a literal opened on an earlier line starts at column 0 of this one
+    Type checker;
+
+    auto push = [&](const string& type, const string& value, size_t start, size_t end) {
+        tokens.push_back({type, value});
+        if (spans) spans->push_back({static_cast<int>(start), static_cast<int>(end)});
+        ct++;
+    };
 
-        if (current_char == '"') { // string literals
-            string str_literal = "";
-            while (file.get(current_char) && current_char != '"') { 
-            // the next character has been read successfully and it is not '"'
+    if (state.in_string) {
+        state.literal += '\n'; // the newline the previous line ended with belongs to the literal
+    }
+
+    while (i <= line.size()) {
+        if (state.in_string) { // string literals
+            while (i < line.size() && line[i] != '"') {
+                char current_char = line[i++];
                 if (current_char == '\\') {
-                    // handle escape sequence
-                    if (file.get(current_char)) {
-                        switch (current_char) {
-                            case 'n': str_literal += '\n'; break;
-                            case 't': str_literal += '\t'; break;
-                            case '\\': str_literal += '\\'; break;
-                            case '"': str_literal += '\"'; break;
-                            default: str_literal += current_char; break;
+                    // handle escape sequence, an escaped line end is kept as the newline
+                    if (i < line.size()) {
+                        switch (line[i++]) {
+                            case 'n': state.literal += '\n'; break;
+                            case 't': state.literal += '\t'; break;
+                            case '\\': state.literal += '\\'; break;
+                            case '"': state.literal += '\"'; break;
+                            default: state.literal += line[i - 1]; break;
                         }
                     }
                 } else {
-                    str_literal += current_char; // adds the current character to the string
+                    state.literal += current_char; // adds the current character to the string
                 }
             }
-            tokens.push_back({"STRING", str_literal}); // inserts the new pair in the vector with tokens
-            ct++;
+            if (i == line.size()) break; // the literal goes on on the next line
+            i++; // the closing '"'
+            push("STRING", state.literal, string_start, i); // inserts the new pair in the vector with tokens
+            state.in_string = false;
+            state.literal.clear();
+            continue;
+        }
+
+        char current_char = i < line.size() ? line[i] : '\n'; // the end of the line separates like '\n' did
+        char next = i + 1 < line.size() ? line[i + 1] : '\n';
+        size_t at = i++;
+        if (current_char == '\r') {
+            continue;
+        }
+        if (current_char == '"') {
+            state.in_string = true;
+            string_start = at;
             continue;
         }
 
         if (isnotsep(current_char)) {
+            if (keyword.empty()) keyword_start = at;
             keyword += current_char; // add the current character to keyword until a separator is meet
-        } else {
-            if (!keyword.empty()) { // if characters were added to keyword
-                if (iskeyword(keyword)) {tokens.push_back({"KEYWORD", keyword});ct++;} // KEYWORD
-		        else if (checker.is_float_numeral(keyword)) {tokens.push_back({"FLOAT", keyword});ct++;} // FLOAT
-                else if (checker.is_integer_numeral(keyword)) {tokens.push_back({"INT", keyword});ct++;} // INT
-		        else {tokens.push_back({"ID", keyword});ct++;} // ID
-                keyword = ""; // reset the keyword
-            }
+            continue;
+        }
+        if (!keyword.empty()) { // if characters were added to keyword
+            size_t keyword_end = keyword_start + keyword.size();
+            if (keyword == "si" || keyword == "sau" || keyword == "nu") push("OP", keyword, keyword_start, keyword_end); // the logical operators are words
+            else if (iskeyword(keyword)) push("KEYWORD", keyword, keyword_start, keyword_end); // KEYWORD
+            else if (checker.is_float_numeral(keyword)) push("FLOAT", keyword, keyword_start, keyword_end); // FLOAT
+            else if (checker.is_integer_numeral(keyword)) push("INT", keyword, keyword_start, keyword_end); // INT
+            else push("ID", keyword, keyword_start, keyword_end); // ID
+            keyword = ""; // reset the keyword
+        }
 
-            // operators
-            if (current_char == '=' || current_char == '!' || current_char == '<' || current_char == '>' || current_char == '+' || current_char == '-' || current_char == '*' || current_char == '/') {
-                if (file.peek() == '=') {
-                    char next_char;
-                    file.get(next_char);
-                    string op = string(1, current_char) + "=";
-                    tokens.push_back({"OP", op});
-                    ct++;
-                } else {
-                    if (current_char == '+' && file.peek() == '+') {
-                        char next_char;
-                        file.get(next_char);
-                        tokens.push_back({"OP", "++"});
-                        ct++;
-                    } else if (current_char == '-' && file.peek() == '-') {
-                        char next_char;
-                        file.get(next_char);
-                        tokens.push_back({"OP", "--"});
-                        ct++;
-                    } else {
-                        tokens.push_back({"OP", string(1, current_char)});
-                        ct++;
-                    }
-                }
+        // operators
+        if (current_char == '=' || current_char == '!' || current_char == '<' || current_char == '>' || current_char == '+' || current_char == '-' || current_char == '*' || current_char == '/') {
+            if (next == '=') {
+                i++;
+                push("OP", string(1, current_char) + "=", at, i);
+            } else if (current_char == '+' && next == '+') {
+                i++;
+                push("OP", "++", at, i);
+            } else if (current_char == '-' && next == '-') {
+                i++;
+                push("OP", "--", at, i);
+            } else {
+                push("OP", string(1, current_char), at, i);
             }
-            
-            // separators
-            else if (current_char == ';') {tokens.push_back({"NLINE", ";"});ct++;}
-            else if (current_char == '%') {tokens.push_back({"OP", "%"});ct++;}
-            else if (current_char == '[') {tokens.push_back({"LBRACKET", "["});ct++;}
-            else if (current_char == ']') {tokens.push_back({"RBRACKET", "]"});ct++;}
-            else if (current_char == '(') {tokens.push_back({"LPAREN", "("});ct++;}
-            else if (current_char == ')') {tokens.push_back({"RPAREN", ")"});ct++;}
-            else if (current_char == '{') {tokens.push_back({"LBRACE", "{"});ct++;}
-            else if (current_char == '}') {tokens.push_back({"RBRACE", "}"});ct++;}
-            else if (current_char == ',') {tokens.push_back({"COMMA", ","});ct++;}
         }
+
+        else if (current_char == '&' || current_char == '|') {
+            if (next == current_char) i++; // && and ||, a single one is not an operator and is reported by the parser
+            push("OP", string(i - at, current_char), at, i);
+        }
+
+        // separators
+        else if (current_char == ';') push("NLINE", ";", at, i);
+        else if (current_char == '%') push("OP", "%", at, i);
+        else if (current_char == '[') push("LBRACKET", "[", at, i);
+        else if (current_char == ']') push("RBRACKET", "]", at, i);
+        else if (current_char == '(') push("LPAREN", "(", at, i);
+        else if (current_char == ')') push("RPAREN", ")", at, i);
+        else if (current_char == '{') push("LBRACE", "{", at, i);
+        else if (current_char == '}') push("RBRACE", "}", at, i);
+        else if (current_char == ',') push("COMMA", ",", at, i);
     }
+    if (state.in_string) state.column = string_start; // where the open literal started, if on this line
+    return ct;
+}
 
-    tpl.push_back(ct); // add the last line token count
+int lex_end(LexState& state, vector<pair<string, string>>& tokens, vector<Span>* spans) {
+    /**
+     * @brief Ends the source: a string literal still open becomes a token.
+     * @return The number of tokens appended, to add to the count of the last line.
+     */
+    if (!state.in_string) return 0;
+    tokens.push_back({"STRING", state.literal});
+    if (spans) spans->push_back({state.column, state.column + 1}); // the opening '"', or the start of the last line
+    state = LexState();
+    return 1;
+}
+
+pair<vector<pair<string, string>>,vector<int>> lexer(istream& file, vector<Span>* spans) {
+    vector<pair<string, string>> tokens;
+    vector<int> tpl; // to store the number of tokens per line
+
+    /**
+     * @brief Tokenizes the content of an already opened stream, line by line.
+     * @param file The stream holding the source code.
+     * @param spans If not null, filled with the columns of every token.
+     * @return A pair containing the vector of tokens and the vector of token counts per line
+     */
+
+    MemScope scope(MemCategory::TOKENS);
+    stringstream content;
+    content << file.rdbuf();
+    const string source = content.str();
+
+    LexState state;
+    size_t begin = 0;
+    while (true) { // the text after the last '\n' is a line too, even when empty
+        memory_line(tpl.size() + 1);
+        size_t end = source.find('\n', begin);
+        tpl.push_back(lex_line(source.substr(begin, end == string::npos ? string::npos : end - begin), state, tokens, spans));
+        if (end == string::npos) break;
+        begin = end + 1;
+    }
+    memory_line(0); // the returned vectors belong to no line
+    tpl.back() += lex_end(state, tokens, spans);
     return {tokens, tpl}; // returns the pair
 }
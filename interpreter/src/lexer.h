@@ -1,7 +1,7 @@
 /**
  * @file lexer.h
  * @brief Header file for the lexer component of the Roscript interpreter.
- * This file contains the declaration of the lexer function.
+ * This file contains the declaration of the lexer function and of the line by line lexer it is built on.
  * @author Rares-Cosma & Vlad-Oprea
  * @date 2025-06-10
  */
@@ -9,12 +9,54 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <istream>
 
 using namespace std;
 
+extern const vector<string> keywords; // the reserved words of the language
+
+using Span = pair<int, int>; // the columns [first, end) of a token on its line, 0-based, in bytes
+
 /**
  * @brief Lexical analyzer function that reads a source file and tokenizes its content.
  * @param fn The file name to read.
  * @return A pair containing a vector of tokens (as pairs of type and value) and a vector of integers representing the number of tokens per line.
  */
-pair<vector<pair<string,string>>,vector<int>> lexer(string fn);
\ No newline at end of file
+pair<vector<pair<string,string>>,vector<int>> lexer(string fn);
+
+/**
+ * @brief Lexical analyzer function that tokenizes source code from an input stream.
+ * @param file The stream to read the source code from.
+ * @param spans If not null, filled with the columns of every token, in token order.
+ * @return The same pair as the file based overload.
+ */
+pair<vector<pair<string,string>>,vector<int>> lexer(istream& file, vector<Span>* spans = nullptr);
+
+/**
+ * @struct LexState
+ * @brief What the lexer carries from one line to the next: a string literal that is still open.
+ */
+struct LexState {
+    bool in_string = false;
+    string literal; // the part of the open literal read so far
+    int column = 0; // where the open literal starts on the current line (0 if it started on an earlier one), not compared
+
+    bool operator==(const LexState& other) const { return in_string == other.in_string && literal == other.literal; }
+    bool operator!=(const LexState& other) const { return !(*this == other); }
+};
+
+/**
+ * @brief Tokenizes one line, so an editor can re-lex only the lines an edit touched.
+ * @param line The line, without its '\n'.
+ * @param state The state the previous line ended in, updated to the state this line ends in.
+ * @param tokens Where the tokens of the line are appended.
+ * @param spans If not null, where the columns of the tokens are appended.
+ * @return The number of tokens appended (the line's entry in the tokens per line).
+ */
+int lex_line(const string& line, LexState& state, vector<pair<string,string>>& tokens, vector<Span>* spans = nullptr);
+
+/**
+ * @brief Closes a string literal left open at the end of the source, which still becomes a token.
+ * @return The number of tokens appended, counted on the last line.
+ */
+int lex_end(LexState& state, vector<pair<string,string>>& tokens, vector<Span>* spans = nullptr);
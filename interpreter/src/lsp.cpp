@@ -0,0 +1,684 @@
+/**
+ * @file lsp.cpp
+ * @brief Language server implementation for the Roscript interpreter.
+ * This file contains `ros --lsp`: a small JSON reader and writer, the JSON-RPC framing, the index of open Documents and the
+ * handlers of the supported requests. Definitions and hovers are answered from the tokens and the AST kept by each Document.
+ * @see lsp.h
+ *
+ * @author Rares-Cosma & Vlad-Oprea
+ * @date 2026-10-18
+ */
+#include "lsp.h"
+#include "document.h"
+#include <map>
+#include <memory>
+#include <sstream>
+#include <iomanip>
+#include <functional>
+
+/**
+ * @struct Json
+ * @brief A JSON value, just enough of it for the protocol messages.
+ */
+struct Json {
+	enum class Kind { NUL, BOOL, NUMBER, STRING, ARRAY, OBJECT };
+
+	Kind kind = Kind::NUL;
+	bool boolean = false;
+	double number = 0;
+	string text;
+	vector<Json> items;
+	map<string, Json> fields;
+
+	Json() = default;
+	Json(bool b) : kind(Kind::BOOL), boolean(b) {}
+	Json(int n) : kind(Kind::NUMBER), number(n) {}
+	Json(double n) : kind(Kind::NUMBER), number(n) {}
+	Json(const char* s) : kind(Kind::STRING), text(s) {}
+	Json(string s) : kind(Kind::STRING), text(move(s)) {}
+	Json(vector<Json> a) : kind(Kind::ARRAY), items(move(a)) {}
+	Json(initializer_list<pair<const string, Json>> object) : kind(Kind::OBJECT), fields(object) {}
+
+	const Json& operator[](const string& key) const {
+		static const Json missing;
+		auto it = fields.find(key);
+		return it == fields.end() ? missing : it->second;
+	}
+	bool is_null() const { return kind == Kind::NUL; }
+	int as_int() const { return static_cast<int>(number); }
+
+	string dump() const {
+		ostringstream out;
+		write(out);
+		return out.str();
+	}
+
+	void write(ostream& out) const {
+		switch (kind) {
+			case Kind::NUL: out << "null"; break;
+			case Kind::BOOL: out << (boolean ? "true" : "false"); break;
+			case Kind::NUMBER:
+				if (number == static_cast<long long>(number)) out << static_cast<long long>(number);
+				else out << setprecision(17) << number;
+				break;
+			case Kind::STRING: write_string(out, text); break;
+			case Kind::ARRAY:
+				out << '[';
+				for (size_t i = 0; i < items.size(); i++) {
+					if (i) out << ',';
+					items[i].write(out);
+				}
+				out << ']';
+				break;
+			case Kind::OBJECT: {
+				out << '{';
+				bool first = true;
+				for (const auto& [key, value] : fields) {
+					if (!first) out << ',';
+					first = false;
+					write_string(out, key);
+					out << ':';
+					value.write(out);
+				}
+				out << '}';
+				break;
+			}
+		}
+	}
+
+	static void write_string(ostream& out, const string& s) {
+		out << '"';
+		for (unsigned char c : s) {
+			if (c == '"') out << "\\\"";
+			else if (c == '\\') out << "\\\\";
+			else if (c == '\n') out << "\\n";
+			else if (c == '\r') out << "\\r";
+			else if (c == '\t') out << "\\t";
+			else if (c < 0x20) out << "\\u" << hex << setw(4) << setfill('0') << static_cast<int>(c) << dec << setfill(' ');
+			else out << c;
+		}
+		out << '"';
+	}
+};
+
+/**
+ * @class JsonReader
+ * @brief Parses one JSON text, throwing runtime_error on malformed input.
+ */
+class JsonReader {
+	public:
+		explicit JsonReader(const string& text) : text(text) {}
+
+		Json parse() {
+			Json value = parse_value();
+			skip_space();
+			if (pos != text.size()) fail();
+			return value;
+		}
+
+	private:
+		const string& text;
+		size_t pos = 0;
+
+		[[noreturn]] void fail() const { throw runtime_error("malformed JSON at byte " + to_string(pos)); }
+
+		void skip_space() {
+			while (pos < text.size() && isspace(static_cast<unsigned char>(text[pos]))) pos++;
+		}
+
+		bool consume(const string& word) {
+			if (text.compare(pos, word.size(), word) != 0) return false;
+			pos += word.size();
+			return true;
+		}
+
+		Json parse_value() {
+			skip_space();
+			if (pos >= text.size()) fail();
+			char c = text[pos];
+			if (c == '{') return parse_object();
+			if (c == '[') return parse_array();
+			if (c == '"') return Json(parse_string());
+			if (consume("true")) return Json(true);
+			if (consume("false")) return Json(false);
+			if (consume("null")) return Json();
+			size_t end;
+			double number;
+			try {
+				number = stod(text.substr(pos, 32), &end);
+			} catch (const exception&) {
+				fail();
+			}
+			pos += end;
+			return Json(number);
+		}
+
+		Json parse_object() {
+			Json object({});
+			pos++; // '{'
+			skip_space();
+			if (consume("}")) return object;
+			while (true) {
+				skip_space();
+				if (pos >= text.size() || text[pos] != '"') fail();
+				string key = parse_string();
+				skip_space();
+				if (!consume(":")) fail();
+				object.fields[key] = parse_value();
+				skip_space();
+				if (consume("}")) return object;
+				if (!consume(",")) fail();
+			}
+		}
+
+		Json parse_array() {
+			Json array(vector<Json>{});
+			pos++; // '['
+			skip_space();
+			if (consume("]")) return array;
+			while (true) {
+				array.items.push_back(parse_value());
+				skip_space();
+				if (consume("]")) return array;
+				if (!consume(",")) fail();
+			}
+		}
+
+		string parse_string() {
+			string result;
+			pos++; // '"'
+			while (pos < text.size() && text[pos] != '"') {
+				char c = text[pos++];
+				if (c != '\\') {
+					result += c;
+					continue;
+				}
+				if (pos >= text.size()) fail();
+				char escape = text[pos++];
+				switch (escape) {
+					case 'n': result += '\n'; break;
+					case 't': result += '\t'; break;
+					case 'r': result += '\r'; break;
+					case 'b': result += '\b'; break;
+					case 'f': result += '\f'; break;
+					case 'u': {
+						if (pos + 4 > text.size()) fail();
+						unsigned code = stoul(text.substr(pos, 4), nullptr, 16);
+						pos += 4;
+						if (code >= 0xD800 && code < 0xDC00 && text.compare(pos, 2, "\\u") == 0) { // a surrogate pair
+							unsigned low = stoul(text.substr(pos + 2, 4), nullptr, 16);
+							pos += 6;
+							code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+						}
+						append_utf8(result, code);
+						break;
+					}
+					default: result += escape; break; // '"', '\\' and '/'
+				}
+			}
+			if (pos >= text.size()) fail();
+			pos++; // '"'
+			return result;
+		}
+
+		static void append_utf8(string& out, unsigned code) {
+			if (code < 0x80) {
+				out += static_cast<char>(code);
+			} else if (code < 0x800) {
+				out += static_cast<char>(0xC0 | (code >> 6));
+				out += static_cast<char>(0x80 | (code & 0x3F));
+			} else if (code < 0x10000) {
+				out += static_cast<char>(0xE0 | (code >> 12));
+				out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+				out += static_cast<char>(0x80 | (code & 0x3F));
+			} else {
+				out += static_cast<char>(0xF0 | (code >> 18));
+				out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+				out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+				out += static_cast<char>(0x80 | (code & 0x3F));
+			}
+		}
+};
+
+static bool word_char(char c) {
+	return isalnum(static_cast<unsigned char>(c)) || c == '_' || static_cast<unsigned char>(c) >= 0x80;
+}
+
+static string word_at(const string& line, int column) {
+	/**
+	 * @brief The identifier under (or just before) the cursor, empty if there is none.
+	 */
+	size_t begin = min<size_t>(max(column, 0), line.size()), end = begin;
+	while (begin > 0 && word_char(line[begin - 1])) begin--;
+	while (end < line.size() && word_char(line[end])) end++;
+	return line.substr(begin, end - begin);
+}
+
+static int word_column(const string& line, const string& word, size_t from = 0) {
+	/**
+	 * @brief Column of the first whole-word occurrence of word at or after `from`, -1 if there is none.
+	 */
+	for (size_t at = line.find(word, from); at != string::npos; at = line.find(word, at + 1)) {
+		bool starts = at == 0 || !word_char(line[at - 1]);
+		bool ends = at + word.size() >= line.size() || !word_char(line[at + word.size()]);
+		if (starts && ends) return at;
+	}
+	return -1;
+}
+
+static int utf16_column(const string& line, int column) {
+	/**
+	 * @brief The UTF-16 code units before a byte column, the unit LSP counts characters in unless utf-8 was negotiated.
+	 * @note Columns past the end of the line (the end of a diagnostic) count one unit per byte.
+	 */
+	int units = 0;
+	size_t at = 0;
+	while (at < line.size() && at < static_cast<size_t>(max(column, 0))) {
+		unsigned char c = line[at];
+		int length = c >> 5 == 6 ? 2 : c >> 4 == 14 ? 3 : c >> 3 == 30 ? 4 : 1; // ASCII and stray bytes count alone
+		units += length == 4 ? 2 : 1; // a code point past U+FFFF takes a surrogate pair
+		at += length;
+	}
+	return units + max(0, column - static_cast<int>(line.size()));
+}
+
+static int byte_column(const string& line, int units) {
+	/**
+	 * @brief The inverse of utf16_column: the byte column `units` UTF-16 code units into the line.
+	 */
+	size_t at = 0;
+	while (at < line.size() && units > 0) {
+		unsigned char c = line[at];
+		int length = c >> 5 == 6 ? 2 : c >> 4 == 14 ? 3 : c >> 3 == 30 ? 4 : 1;
+		units -= length == 4 ? 2 : 1;
+		at = min(line.size(), at + length);
+	}
+	return at + max(0, units);
+}
+
+static Json position(int line, int character) {
+	return Json({{"line", line}, {"character", character}});
+}
+
+static Json range(int line, int start, int end) {
+	return Json({{"start", position(line, start)}, {"end", position(line, end)}});
+}
+
+/**
+ * @struct Declaration
+ * @brief Where a name is declared: the keyword that declares it and its 1-based line.
+ */
+struct Declaration {
+	int line;
+	string keyword; // "var", "functie" or "fiecare"
+};
+
+static vector<Declaration> find_declarations(const Document& document, const string& name) {
+	/**
+	 * @brief Every declaration of the name, in source order: `var name`, `functie name` and `pentru fiecare [paralel] name`.
+	 */
+	vector<Declaration> found;
+	const vector<Token>& tokens = document.tokens();
+	for (size_t i = 0; i + 1 < tokens.size(); i++) {
+		if (tokens[i].type != "KEYWORD") continue;
+		const string& keyword = tokens[i].value;
+		size_t at = i + 1;
+		if (keyword == "fiecare" && tokens[at].value == "paralel" && at + 1 < tokens.size()) at++;
+		if ((keyword == "var" || keyword == "functie" || keyword == "fiecare") && tokens[at].type == "ID" && tokens[at].value == name) {
+			found.push_back({tokens[at].line_nb, keyword});
+		}
+	}
+	return found;
+}
+
+static const Declaration* nearest(const vector<Declaration>& declarations, int line) {
+	/**
+	 * @brief The last declaration at or before the line (1-based), or the first one if they all come after it.
+	 */
+	const Declaration* best = declarations.empty() ? nullptr : &declarations.front();
+	for (const Declaration& d : declarations) {
+		if (d.line <= line) best = &d;
+	}
+	return best;
+}
+
+static void visit(const vector<ASTNode*>& block, const function<void(ASTNode*, int)>& f, int parent_line = 0) {
+	/**
+	 * @brief Calls f on every statement, nested ones included, with the statement's line (the enclosing one's if it has none).
+	 */
+	for (ASTNode* node : block) {
+		if (!node) continue;
+		int line = node->line ? node->line : parent_line;
+		f(node, line);
+		if (auto ifs = dynamic_cast<IfStatement*>(node)) {
+			visit(ifs->block, f, line);
+			for (auto& branch : ifs->elseIfBranches) visit(branch.second, f, line);
+			visit(ifs->elseBlock, f, line);
+		} else if (auto sw = dynamic_cast<SwitchStatement*>(node)) {
+			for (auto& c : sw->cases) visit(c.second, f, line);
+			visit(sw->elseBlock, f, line);
+		} else if (auto loop = dynamic_cast<WhileStatement*>(node)) {
+			visit(loop->block, f, line);
+		} else if (auto loop = dynamic_cast<DoWhileStatement*>(node)) {
+			visit(loop->block, f, line);
+		} else if (auto loop = dynamic_cast<DoUntilStatement*>(node)) {
+			visit(loop->block, f, line);
+		} else if (auto loop = dynamic_cast<ForStatement*>(node)) {
+			visit({loop->init_block}, f, line);
+			visit(loop->block, f, line);
+		} else if (auto loop = dynamic_cast<ForEachStatement*>(node)) {
+			visit(loop->block, f, line);
+		} else if (auto func = dynamic_cast<FunctionDefinition*>(node)) {
+			visit(func->args, f, line);
+			visit(func->block, f, line);
+		}
+	}
+}
+
+static const ASTNode* variable_node(const Document& document, const string& name, int line) {
+	/**
+	 * @brief The VariableDeclaration or ForEachStatement declaring the variable, the last one at or before the line if any.
+	 */
+	const ASTNode* best = nullptr;
+	int best_line = 0;
+	visit(document.parser.AST, [&](ASTNode* node, int at) {
+		auto decl = dynamic_cast<VariableDeclaration*>(node);
+		auto loop = dynamic_cast<ForEachStatement*>(node);
+		if (!(decl && decl->name == name) && !(loop && loop->name == name)) return;
+		if (!best || (at <= line && at >= best_line) || (best_line > line && at < best_line)) {
+			best = node;
+			best_line = at;
+		}
+	});
+	return best;
+}
+
+static string infer_type(const Expr* expr, const Document& document, int line, int depth = 0) {
+	/**
+	 * @brief The type an expression evaluates to, as far as it can be told without running it; empty when unknown.
+	 */
+	if (!expr || depth > 16) return "";
+	if (dynamic_cast<const IntLiteral*>(expr)) return "int";
+	if (dynamic_cast<const FloatLiteral*>(expr)) return "float";
+	if (dynamic_cast<const StringLiteral*>(expr)) return "string";
+	if (dynamic_cast<const BoolLiteral*>(expr) || dynamic_cast<const NotExpr*>(expr) || dynamic_cast<const LogicalExpr*>(expr)) return "bool";
+	if (dynamic_cast<const SpawnExpr*>(expr)) return "int"; // a task id
+	if (auto ref = dynamic_cast<const Refrence*>(expr)) {
+		const ASTNode* node = variable_node(document, ref->name, line);
+		if (auto decl = dynamic_cast<const VariableDeclaration*>(node)) return infer_type(decl->value, document, decl->line ? decl->line : line, depth + 1);
+		if (auto loop = dynamic_cast<const ForEachStatement*>(node)) return loop->sequence ? "string" : "int";
+		return "";
+	}
+	if (auto call = dynamic_cast<const FunctionCall*>(expr)) {
+		auto it = stdlib_signatures.find(call->name);
+		return it == stdlib_signatures.end() ? "" : it->second.result;
+	}
+	if (auto bin = dynamic_cast<const BinaryExpr*>(expr)) {
+		static const vector<string> comparisons = {"<", ">", "<=", ">=", "==", "!="};
+		if (find(comparisons.begin(), comparisons.end(), bin->op) != comparisons.end()) return "bool";
+		string left = infer_type(bin->left, document, line, depth + 1), right = infer_type(bin->right, document, line, depth + 1);
+		if (left == "string" || right == "string") return bin->op == "+" ? "string" : "";
+		if (left.empty() || right.empty()) return "";
+		if (left == "float" || right == "float") return "float";
+		return "int";
+	}
+	return "";
+}
+
+/**
+ * @class LanguageServer
+ * @brief The state of one `ros --lsp` session: the open documents and the output channel.
+ */
+class LanguageServer {
+	public:
+		explicit LanguageServer(ostream& out) : out(out) {}
+
+		bool shutdown_requested = false;
+
+		void handle(const Json& message) {
+			/**
+			 * @brief Dispatches one request or notification; requests get exactly one response.
+			 */
+			const string& method = message["method"].text;
+			const Json& params = message["params"];
+			const Json& id = message["id"];
+			bool request = !id.is_null();
+
+			if (method == "initialize") {
+				for (const Json& encoding : params["capabilities"]["general"]["positionEncodings"].items) {
+					if (encoding.text == "utf-8") utf8 = true; // the byte columns the lexer produces, no conversion needed
+				}
+				Json capabilities({
+					{"positionEncoding", utf8 ? "utf-8" : "utf-16"},
+					{"textDocumentSync", Json({{"openClose", true}, {"change", 2}})}, // 2: incremental changes
+					{"definitionProvider", true},
+					{"hoverProvider", true},
+					{"completionProvider", Json({{"resolveProvider", false}})},
+				});
+				respond(id, Json({{"capabilities", capabilities}, {"serverInfo", Json({{"name", "roscript"}})}}));
+			} else if (method == "shutdown") {
+				shutdown_requested = true;
+				respond(id, Json());
+			} else if (method == "textDocument/didOpen") {
+				const Json& item = params["textDocument"];
+				auto& document = documents[item["uri"].text];
+				document.reset(new Document());
+				document->set_text(item["text"].text);
+				publish(item["uri"].text);
+			} else if (method == "textDocument/didChange") {
+				const string& uri = params["textDocument"]["uri"].text;
+				Document& document = open(uri);
+				for (const Json& change : params["contentChanges"].items) {
+					const Json& r = change["range"];
+					if (r.is_null()) {
+						document.set_text(change["text"].text);
+					} else {
+						document.edit(r["start"]["line"].as_int(), from_client(document, r["start"]), r["end"]["line"].as_int(),
+						              from_client(document, r["end"]), change["text"].text);
+					}
+				}
+				publish(uri);
+			} else if (method == "textDocument/didClose") {
+				const string& uri = params["textDocument"]["uri"].text;
+				documents.erase(uri);
+				notify("textDocument/publishDiagnostics", Json({{"uri", uri}, {"diagnostics", vector<Json>()}}));
+			} else if (method == "textDocument/definition") {
+				respond(id, definition(params));
+			} else if (method == "textDocument/hover") {
+				respond(id, hover(params));
+			} else if (method == "textDocument/completion") {
+				respond(id, completion(params));
+			} else if (request) {
+				respond_error(id, -32601, "Method not found: " + method);
+			}
+		}
+
+		void respond_error(const Json& id, int code, const string& message) {
+			send(Json({{"jsonrpc", "2.0"}, {"id", id}, {"error", Json({{"code", code}, {"message", message}})}}));
+		}
+
+	private:
+		ostream& out;
+		map<string, unique_ptr<Document>> documents; // by uri
+		bool utf8 = false; // the client counts columns in bytes, not in UTF-16 code units
+
+		int to_client(const string& line, int column) const {
+			return utf8 ? column : utf16_column(line, column);
+		}
+
+		int from_client(const Document& document, const Json& at) const {
+			/**
+			 * @brief The byte column of a client position in the document, as the lexer counts columns.
+			 */
+			int line = at["line"].as_int(), character = at["character"].as_int();
+			if (utf8 || line < 0 || line >= document.line_count()) return character;
+			return byte_column(document.line(line), character);
+		}
+
+		Document& open(const string& uri) {
+			auto& document = documents[uri];
+			if (!document) { // a change for a file that was never opened starts from an empty one
+				document.reset(new Document());
+				document->set_text("");
+			}
+			return *document;
+		}
+
+		void send(const Json& message) {
+			string body = message.dump();
+			out << "Content-Length: " << body.size() << "\r\n\r\n" << body;
+			out.flush();
+		}
+
+		void respond(const Json& id, const Json& result) {
+			send(Json({{"jsonrpc", "2.0"}, {"id", id}, {"result", result}}));
+		}
+
+		void notify(const string& method, const Json& params) {
+			send(Json({{"jsonrpc", "2.0"}, {"method", method}, {"params", params}}));
+		}
+
+		void publish(const string& uri) {
+			const Document& document = *documents[uri];
+			vector<Json> diagnostics;
+			for (const SyntaxError& error : document.diagnostics()) {
+				int line = max(0, min(error.line_nb, document.line_count()) - 1);
+				const string& text = document.line(line);
+				int end = max(error.end_column, error.column + 1);
+				diagnostics.push_back(Json({
+					{"range", range(line, to_client(text, error.column), to_client(text, end))},
+					{"severity", error.warning ? 2 : 1},
+					{"source", "roscript"},
+					{"message", error.message},
+				}));
+			}
+			notify("textDocument/publishDiagnostics", Json({{"uri", uri}, {"diagnostics", diagnostics}}));
+		}
+
+		const Document* find(const Json& params, int& line, int& column) {
+			/**
+			 * @brief The document and the 0-based cursor position a textDocument/position request is about.
+			 */
+			auto it = documents.find(params["textDocument"]["uri"].text);
+			if (it == documents.end()) return nullptr;
+			line = params["position"]["line"].as_int();
+			if (line < 0 || line >= it->second->line_count()) return nullptr;
+			column = from_client(*it->second, params["position"]);
+			return it->second.get();
+		}
+
+		Json definition(const Json& params) {
+			int line, column;
+			const Document* document = find(params, line, column);
+			if (!document) return Json();
+			string name = word_at(document->line(line), column);
+			if (name.empty()) return Json();
+
+			vector<Declaration> declarations = find_declarations(*document, name);
+			const Declaration* decl = nearest(declarations, line + 1);
+			if (!decl) return Json();
+			const string& text = document->line(decl->line - 1);
+			int keyword = word_column(text, decl->keyword);
+			int at = word_column(text, name, keyword < 0 ? 0 : keyword + decl->keyword.size());
+			if (at < 0) at = 0;
+			int end = at + name.size();
+			return Json({{"uri", params["textDocument"]["uri"]}, {"range", range(decl->line - 1, to_client(text, at), to_client(text, end))}});
+		}
+
+		Json hover(const Json& params) {
+			int line, column;
+			const Document* document = find(params, line, column);
+			if (!document) return Json();
+			string name = word_at(document->line(line), column);
+			if (name.empty() || std::find(keywords.begin(), keywords.end(), name) != keywords.end()) return Json();
+
+			string text;
+			if (auto func = find_function(&document->parser.functionDefinitions, name)) {
+				text = "functie " + name + "(";
+				for (size_t i = 0; i < func->args.size(); i++) {
+					auto* param = static_cast<VariableDeclaration*>(func->args[i]);
+					text += (i ? ", var " : "var ") + param->name;
+				}
+				text += ")";
+			} else if (stdlib.find(name) != stdlib.end()) {
+				text = "(builtin) " + name;
+			} else if (const ASTNode* node = variable_node(*document, name, line + 1)) {
+				string type;
+				if (auto decl = dynamic_cast<const VariableDeclaration*>(node)) type = infer_type(decl->value, *document, line + 1);
+				else type = static_cast<const ForEachStatement*>(node)->sequence ? "string" : "int";
+				text = "var " + name + (type.empty() ? "" : ": " + type);
+			} else {
+				return Json();
+			}
+			return Json({{"contents", Json({{"kind", "plaintext"}, {"value", text}})}});
+		}
+
+		Json completion(const Json& params) {
+			int line, column;
+			const Document* document = find(params, line, column);
+			vector<Json> items;
+			map<string, int> seen; // label -> CompletionItemKind
+			auto add = [&](const string& label, int kind) {
+				if (seen.emplace(label, kind).second) items.push_back(Json({{"label", label}, {"kind", kind}}));
+			};
+			for (const string& keyword : keywords) add(keyword, 14); // Keyword
+			for (const auto& builtin : stdlib) add(builtin.first, 3); // Function
+			if (document) {
+				for (const string& func : document->parser.parser_user_defined_fn.names()) add(func, 3);
+				for (const string& variable : document->parser.parser_variables.names()) add(variable, 6); // Variable
+				const vector<ASTNode*>& AST = document->parser.AST;
+				for (size_t i = 0; i < AST.size(); i++) { // the parameters and locals of the function the cursor is in
+					auto func = dynamic_cast<FunctionDefinition*>(AST[i]);
+					if (!func || func->line > line + 1 || (i + 1 < AST.size() && AST[i + 1]->line <= line + 1)) continue;
+					visit(func->args, [&](ASTNode* node, int) {
+						if (auto decl = dynamic_cast<VariableDeclaration*>(node)) add(decl->name, 6);
+					});
+					visit(func->block, [&](ASTNode* node, int) {
+						if (auto decl = dynamic_cast<VariableDeclaration*>(node)) add(decl->name, 6);
+						else if (auto loop = dynamic_cast<ForEachStatement*>(node)) add(loop->name, 6);
+					});
+				}
+			}
+			return Json({{"isIncomplete", false}, {"items", items}});
+		}
+};
+
+static bool read_message(istream& in, string& body) {
+	/**
+	 * @brief Reads one JSON-RPC message: headers up to an empty line, then Content-Length bytes.
+	 */
+	long length = -1;
+	string header;
+	while (getline(in, header)) {
+		if (!header.empty() && header.back() == '\r') header.pop_back();
+		if (header.empty()) {
+			if (length < 0) continue; // stray blank line between messages
+			body.resize(length);
+			return static_cast<bool>(in.read(&body[0], length));
+		}
+		const string key = "Content-Length:";
+		if (header.compare(0, key.size(), key) == 0) length = stol(header.substr(key.size()));
+	}
+	return false;
+}
+
+int run_lsp(istream& in, ostream& out) {
+	LanguageServer server(out);
+	string body;
+	while (read_message(in, body)) {
+		Json message;
+		try {
+			message = JsonReader(body).parse();
+		} catch (const exception& e) {
+			server.respond_error(Json(), -32700, e.what()); // parse error
+			continue;
+		}
+		if (message["method"].text == "exit") return server.shutdown_requested ? 0 : 1;
+		try {
+			server.handle(message);
+		} catch (const exception& e) {
+			if (!message["id"].is_null()) server.respond_error(message["id"], -32603, e.what()); // internal error
+		}
+	}
+	return server.shutdown_requested ? 0 : 1;
+}
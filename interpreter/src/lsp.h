@@ -0,0 +1,27 @@
+/**
+ * @file lsp.h
+ * @brief Header file for the language server mode of the Roscript interpreter.
+ * `ros --lsp` speaks the Language Server Protocol (JSON-RPC with Content-Length headers) over stdin and stdout, so editors
+ * get diagnostics, go-to-definition, completion and hovers without shelling out to `ros` for every keystroke.
+ * @author Rares-Cosma & Vlad-Oprea
+ * @date 2026-10-18
+ */
+
+#pragma once
+#include <iostream>
+
+using namespace std;
+
+/**
+ * @brief Serves LSP requests until the client sends `exit` or closes the input.
+ * @param in The stream the client writes to (stdin).
+ * @param out The stream the responses and notifications are written to (stdout).
+ * @return 0 after a `shutdown` request, 1 otherwise, as the protocol asks of the exit code.
+ * @note Every open file is kept as a Document, updated incrementally from the `didChange` ranges. Supported:
+ * - textDocument/didOpen, didChange (full or incremental), didClose, each answered with textDocument/publishDiagnostics;
+ * - textDocument/definition for variables, parameters, loop variables and functions;
+ * - textDocument/completion with the keywords, the stdlib builtins and the names declared in the file;
+ * - textDocument/hover with the builtin or function signature, or the type inferred from a variable's declaration.
+ * Columns are counted in bytes, which matches UTF-16 units for ASCII source.
+ */
+int run_lsp(istream& in, ostream& out);
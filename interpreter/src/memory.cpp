@@ -0,0 +1,145 @@
+/**
+ * @file memory.cpp
+ * @brief Memory profiler implementation for the Roscript interpreter.
+ * This file replaces the global operator new and delete. They always go straight to malloc and free, and only count while
+ * memory_tracking is set or a memory budget is installed, using malloc_usable_size so no header has to be stored in front of the blocks.
+ * @see memory.h
+ *
+ * @author Rares-Cosma & Vlad-Oprea
+ * @date 2026-10-18
+ */
+#include "memory.h"
+#include <new>
+#include <cstdlib>
+#include <malloc.h>
+#include <sys/resource.h>
+#include <vector>
+#include <algorithm>
+#include <iomanip>
+
+atomic<bool> memory_tracking{false};
+thread_local MemoryAttribution memory_attribution;
+thread_local MemoryBudget* memory_budget = nullptr;
+
+/**
+ * @struct AllocationCounter
+ * @brief Number and total size of the allocations charged to a category or a line.
+ */
+struct AllocationCounter {
+	atomic<long long> count{0};
+	atomic<long long> bytes{0};
+};
+
+static const int max_lines = 1 << 16; // allocations on later lines are charged to the last one
+static AllocationCounter category_counters[static_cast<int>(MemCategory::COUNT)];
+static AllocationCounter line_counters[max_lines];
+static atomic<long long> live_bytes{0}, peak_bytes{0};
+
+static void record_allocation(void* ptr) {
+	long long size = malloc_usable_size(ptr);
+	const MemoryAttribution& attribution = memory_attribution;
+	AllocationCounter& category = category_counters[static_cast<int>(attribution.category)];
+	category.count.fetch_add(1, memory_order_relaxed);
+	category.bytes.fetch_add(size, memory_order_relaxed);
+	AllocationCounter& line = line_counters[min(max(attribution.line, 0), max_lines - 1)];
+	line.count.fetch_add(1, memory_order_relaxed);
+	line.bytes.fetch_add(size, memory_order_relaxed);
+
+	long long live = live_bytes.fetch_add(size, memory_order_relaxed) + size;
+	long long peak = peak_bytes.load(memory_order_relaxed);
+	while (live > peak && !peak_bytes.compare_exchange_weak(peak, live, memory_order_relaxed)) {}
+}
+
+void* operator new(size_t size) {
+	void* ptr = malloc(size ? size : 1);
+	if (!ptr) throw bad_alloc();
+	if (MemoryBudget* budget = memory_budget) budget->used.fetch_add(malloc_usable_size(ptr), memory_order_relaxed);
+	if (memory_tracking.load(memory_order_relaxed)) record_allocation(ptr);
+	return ptr;
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+	if (!ptr) return;
+	if (MemoryBudget* budget = memory_budget) budget->used.fetch_sub(malloc_usable_size(ptr), memory_order_relaxed);
+	if (memory_tracking.load(memory_order_relaxed)) {
+		live_bytes.fetch_sub(malloc_usable_size(ptr), memory_order_relaxed);
+	}
+	free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+	operator delete(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+	operator delete(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+	operator delete(ptr);
+}
+
+void memory_tracking_start() {
+	for (AllocationCounter& counter : category_counters) {
+		counter.count = 0;
+		counter.bytes = 0;
+	}
+	for (AllocationCounter& counter : line_counters) {
+		counter.count = 0;
+		counter.bytes = 0;
+	}
+	live_bytes = 0;
+	peak_bytes = 0;
+	memory_tracking = true;
+}
+
+void memory_tracking_stop() {
+	memory_tracking = false;
+}
+
+void memory_report(ostream& out) {
+	static const char* category_names[] = {"other", "tokens", "AST", "values", "strings", "frames"};
+
+	bool tracking = memory_tracking.exchange(false); // the report allocates too
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	long long total_count = 0, total_bytes = 0;
+	for (const AllocationCounter& counter : category_counters) {
+		total_count += counter.count;
+		total_bytes += counter.bytes;
+	}
+
+	out << "\nMemory profile:\n";
+	out << "Peak RSS: " << usage.ru_maxrss << " KB\n";
+	out << "Allocated: " << total_bytes << " bytes in " << total_count << " allocations, peak live heap: "
+	    << peak_bytes.load() << " bytes\n";
+	out << "By category:\n";
+	for (int c = 0; c < static_cast<int>(MemCategory::COUNT); c++) {
+		const AllocationCounter& counter = category_counters[c];
+		if (counter.count == 0) continue;
+		out << "  " << left << setw(8) << category_names[c] << right << setw(14) << counter.bytes << " bytes" << setw(12)
+		    << counter.count << " allocations" << fixed << setprecision(1) << setw(8)
+		    << (total_bytes ? 100.0 * counter.bytes / total_bytes : 0) << "%\n";
+	}
+
+	vector<int> lines;
+	for (int line = 1; line < max_lines; line++) {
+		if (line_counters[line].count) lines.push_back(line);
+	}
+	sort(lines.begin(), lines.end(), [](int a, int b) { return line_counters[a].bytes > line_counters[b].bytes; });
+	if (lines.size() > 10) lines.resize(10);
+	out << "Top source lines:\n";
+	for (int line : lines) {
+		out << "  line " << left << setw(6) << line << right << setw(14) << line_counters[line].bytes << " bytes" << setw(12)
+		    << line_counters[line].count << " allocations\n";
+	}
+	if (line_counters[0].count) {
+		out << "  outside statements " << line_counters[0].bytes << " bytes in " << line_counters[0].count << " allocations\n";
+	}
+	memory_tracking = tracking;
+}
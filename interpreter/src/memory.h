@@ -0,0 +1,107 @@
+/**
+ * @file memory.h
+ * @brief Header file for the memory profiler of the Roscript interpreter.
+ * While `ros -m` runs, the replaced global operator new counts every allocation by category (tokens, AST, values, strings, frames)
+ * and by source line, and the report at exit adds the peak RSS of the process.
+ * @author Rares-Cosma & Vlad-Oprea
+ * @date 2026-10-18
+ */
+
+#pragma once
+#include <atomic>
+#include <ostream>
+
+using namespace std;
+
+/**
+ * @enum MemCategory
+ * @brief What an allocation is for, set by the component that is running.
+ */
+enum class MemCategory { OTHER, TOKENS, AST, VALUES, STRINGS, FRAMES, COUNT };
+
+/**
+ * @struct MemoryAttribution
+ * @brief The category and source line new allocations of a thread are charged to.
+ */
+struct MemoryAttribution {
+	MemCategory category = MemCategory::OTHER;
+	int line = 0; // 0 when no statement is running
+};
+
+extern atomic<bool> memory_tracking; // true while allocations are counted
+extern thread_local MemoryAttribution memory_attribution;
+
+/**
+ * @brief Resets the counters and starts counting allocations.
+ */
+void memory_tracking_start();
+
+/**
+ * @brief Stops counting allocations, keeping the counters for memory_report().
+ */
+void memory_tracking_stop();
+
+/**
+ * @brief Prints peak RSS, total bytes and allocations, the split by category and the source lines that allocated the most.
+ * @param out Where the report is written.
+ */
+void memory_report(ostream& out);
+
+/**
+ * @class MemScope
+ * @brief Charges the allocations made during its lifetime to a category, then restores the previous one.
+ * @note Costs a single relaxed load when the profiler is off.
+ */
+class MemScope {
+	public:
+		MemScope(MemCategory category) : active(memory_tracking.load(memory_order_relaxed)) {
+			if (active) {
+				previous = memory_attribution.category;
+				memory_attribution.category = category;
+			}
+		}
+
+		~MemScope() {
+			if (active) memory_attribution.category = previous;
+		}
+
+	private:
+		bool active;
+		MemCategory previous = MemCategory::OTHER;
+};
+
+/**
+ * @struct MemoryBudget
+ * @brief The heap bytes a script may keep allocated, charged by operator new on every thread the budget is installed on.
+ * @note Going over the limit only sets the counter past it, the interpreter checks exceeded() at its safe points and aborts
+ * the script there, so no allocation inside the standard library ever fails.
+ */
+struct MemoryBudget {
+	atomic<long long> used{0};
+	long long limit;
+
+	MemoryBudget(long long limit) : limit(limit) {}
+	bool exceeded() const { return used.load(memory_order_relaxed) > limit; }
+};
+
+extern thread_local MemoryBudget* memory_budget; // the budget charged by this thread's allocations, nullptr for none
+
+/**
+ * @class BudgetScope
+ * @brief Installs a memory budget on the calling thread for its lifetime.
+ */
+class BudgetScope {
+	public:
+		BudgetScope(MemoryBudget* budget) : previous(memory_budget) { memory_budget = budget; }
+		~BudgetScope() { memory_budget = previous; }
+
+	private:
+		MemoryBudget* previous;
+};
+
+inline void memory_line(int line) {
+	/**
+	 * @brief Charges the following allocations of this thread to a source line.
+	 */
+	if (memory_tracking.load(memory_order_relaxed)) memory_attribution.line = line;
+}
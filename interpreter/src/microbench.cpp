@@ -0,0 +1,287 @@
+/**
+ * @file microbench.cpp
+ * @brief Microbenchmarks of the internal components of the Roscript interpreter.
+ * This file is the `microbench` executable built by compile.sh from the same objects as `ros` (minus roscript.o). It times
+ * lexer(), TokenStream::init, Parser::parse_expression, Document::edit, BinaryExpr::eval per operand type pair and the call
+ * overhead of every stdlib builtin, and reports cycles and instructions per operation when the kernel allows perf_event_open.
+ *
+ * Usage: `microbench [filter]` runs the benchmarks whose name contains filter.
+ *
+ * @author Rares-Cosma & Vlad-Oprea
+ * @date 2026-10-18
+ */
+#include "lexer.h"
+#include "parser.h"
+#include "bench.h"
+#include "document.h"
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace chrono;
+
+/**
+ * @class PerfCounters
+ * @brief Hardware cycle and instruction counters of the calling thread, read through perf_event_open.
+ * @note Unavailable in most containers and when perf_event_paranoid forbids it; the benchmarks then report time only.
+ */
+class PerfCounters {
+	public:
+		PerfCounters() {
+			cycles = open_counter(PERF_COUNT_HW_CPU_CYCLES, -1);
+			if (cycles >= 0) instructions = open_counter(PERF_COUNT_HW_INSTRUCTIONS, cycles);
+			if (instructions < 0 && cycles >= 0) {
+				close(cycles);
+				cycles = -1;
+			}
+		}
+
+		~PerfCounters() {
+			if (instructions >= 0) close(instructions);
+			if (cycles >= 0) close(cycles);
+		}
+
+		bool available() const { return cycles >= 0; }
+
+		void start() {
+			if (!available()) return;
+			ioctl(cycles, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+			ioctl(cycles, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+		}
+
+		void stop(long long& cycle_count, long long& instruction_count) {
+			cycle_count = instruction_count = 0;
+			if (!available()) return;
+			ioctl(cycles, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+			if (read(cycles, &cycle_count, sizeof(cycle_count)) != sizeof(cycle_count)) cycle_count = 0;
+			if (read(instructions, &instruction_count, sizeof(instruction_count)) != sizeof(instruction_count)) instruction_count = 0;
+		}
+
+	private:
+		int cycles = -1, instructions = -1;
+
+		static int open_counter(unsigned long long config, int group) {
+			perf_event_attr attr;
+			memset(&attr, 0, sizeof(attr));
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.size = sizeof(attr);
+			attr.config = config;
+			attr.disabled = group < 0; // the group leader starts disabled, members follow it
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			return syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+		}
+};
+
+/**
+ * @struct Sample
+ * @brief One timed run of a microbenchmark.
+ */
+struct Sample {
+	double ns = 0;
+	long long cycles = 0, instructions = 0;
+};
+
+static PerfCounters counters;
+static string filter;
+static const int runs = 5; // timed runs per benchmark, the median one is reported
+
+static void report_header() {
+	cout << left << setw(30) << "Benchmark" << right << setw(14) << "ops/run" << setw(12) << "ns/op" << setw(14) << "Mops/s"
+	     << setw(12) << "cycles/op" << setw(12) << "instr/op" << "\n";
+}
+
+static void bench(const string& name, long long ops, const function<void()>& setup, const function<void()>& body) {
+	/**
+	 * @brief Times `body`, which performs `ops` operations, after one warm-up run; `setup` runs untimed before every run.
+	 */
+	if (!filter.empty() && name.find(filter) == string::npos) return;
+
+	vector<Sample> samples;
+	for (int run = 0; run <= runs; run++) {
+		setup();
+		Sample sample;
+		auto start = steady_clock::now();
+		counters.start();
+		body();
+		counters.stop(sample.cycles, sample.instructions);
+		sample.ns = duration<double, nano>(steady_clock::now() - start).count();
+		if (run > 0) samples.push_back(sample); // run 0 is the warm-up
+	}
+	sort(samples.begin(), samples.end(), [](const Sample& a, const Sample& b) { return a.ns < b.ns; });
+	const Sample& median = samples[samples.size() / 2];
+
+	cout << left << setw(30) << name << right << setw(14) << ops << fixed << setprecision(2) << setw(12) << median.ns / ops
+	     << setw(14) << ops / median.ns * 1000;
+	if (counters.available()) {
+		cout << setw(12) << double(median.cycles) / ops << setw(12) << double(median.instructions) / ops;
+	} else {
+		cout << setw(12) << "n/a" << setw(12) << "n/a";
+	}
+	cout << "\n";
+}
+
+static void bench_lexer() {
+	string source = generate_script(2000);
+	istringstream probe(source);
+	long long tokens = lexer(probe).first.size();
+	bench("lexer (tokens)", tokens, [] {}, [&] {
+		istringstream stream(source);
+		lexer(stream);
+	});
+}
+
+static void bench_token_stream() {
+	string source = generate_script(2000);
+	istringstream stream(source);
+	auto tokens = lexer(stream);
+	TokenStream token_stream;
+	bench("TokenStream::init (tokens)", tokens.first.size(), [&] {
+		token_stream.raw_tokens = tokens.first;
+		token_stream.tokens.clear();
+	}, [&] {
+		token_stream.init(tokens.second);
+	});
+}
+
+static long long count_nodes(Expr* expr) {
+	auto bin = dynamic_cast<BinaryExpr*>(expr);
+	return bin ? 1 + count_nodes(bin->left) + count_nodes(bin->right) : 1;
+}
+
+static void bench_parse_expression() {
+	// 200 operands mixing every precedence level, repeated on as many lines
+	string line = "1";
+	const char* ops[] = {"+", "*", "-", "/", "<", "%"};
+	for (int i = 1; i < 200; i++) line += string(" ") + ops[i % 6] + " " + (i % 3 ? to_string(i) : "(" + to_string(i) + " + 2.5)");
+	string source;
+	for (int i = 0; i < 200; i++) source += line + ";\n";
+
+	istringstream stream(source);
+	auto tokens = lexer(stream);
+	TokenStream token_stream;
+	token_stream.raw_tokens = tokens.first;
+	token_stream.init(tokens.second);
+	const vector<Token>& expr_tokens = token_stream.tokens;
+
+	ostringstream errors;
+	Parser parser;
+	parser.err = &errors;
+	vector<Expr*> parsed;
+	auto parse_all = [&] {
+		int idx = 0;
+		while (idx < static_cast<int>(expr_tokens.size())) {
+			parsed.push_back(parser.parse_expression(expr_tokens, idx));
+			idx++; // the ';'
+		}
+	};
+	parse_all();
+	long long nodes = 0;
+	for (Expr* expr : parsed) nodes += count_nodes(expr);
+
+	bench("parse_expression (nodes)", nodes, [&] {
+		for (Expr* expr : parsed) delete expr;
+		parsed.clear();
+	}, parse_all);
+	for (Expr* expr : parsed) delete expr;
+}
+
+static void bench_document() {
+	// one keystroke typed and deleted again on a line in the middle of a large file
+	Document document;
+	document.set_text(generate_script(2000));
+	const int line = document.line_count() / 2;
+	const long long edits = 200;
+	bench("Document::edit (edits)", edits, [] {}, [&] {
+		for (long long i = 0; i < edits; i += 2) {
+			document.edit(line, 0, line, 0, " ");
+			document.edit(line, 0, line, 1, "");
+		}
+	});
+}
+
+static Expr* literal(const Value& v) {
+	if (holds_alternative<int>(v)) return new IntLiteral(get<int>(v));
+	if (holds_alternative<float>(v)) return new FloatLiteral(get<float>(v));
+	if (holds_alternative<bool>(v)) return new BoolLiteral(get<bool>(v));
+	return new StringLiteral(get<string>(v));
+}
+
+static void bench_binary_expr() {
+	struct Case {
+		string name;
+		Value left, right;
+		vector<string> ops;
+	};
+	vector<Case> cases = {
+		{"int,int", 7, 3, {"+", "*", "/", "%", "<", "=="}},
+		{"float,float", 7.5f, 2.5f, {"+", "*", "/", "<"}},
+		{"int,float", 7, 2.5f, {"+", "*", "<"}},
+		{"string,string", string("abcdefgh"), string("ijklmnop"), {"+", "=="}},
+	};
+
+	Context ctx;
+	const long long ops = 1000000;
+	for (const Case& c : cases) {
+		for (const string& op : c.ops) {
+			BinaryExpr expr(literal(c.left), op, literal(c.right));
+			bench("BinaryExpr " + c.name + " " + op, ops, [] {}, [&] {
+				for (long long i = 0; i < ops; i++) {
+					Value result = expr.eval(ctx);
+					asm volatile("" : : "r"(&result) : "memory"); // keep the result alive
+				}
+			});
+		}
+	}
+}
+
+static void bench_stdlib() {
+	// sample arguments per builtin; builtins missing here (e.g. citeste, which needs input) are skipped
+	vector<pair<string, vector<Value>>> calls = {
+		{"int", {string("12345")}},
+		{"float", {42}},
+		{"bool", {1}},
+		{"string", {12345}},
+		{"lungime", {string("abcdefgh")}},
+		{"tip", {2.5f}},
+		{"sqrt", {2.0f}},
+		{"afiseaza", {string("x"), 1}},
+	};
+
+	ostream null_stream(nullptr); // discards everything afiseaza writes
+	Context ctx;
+	ctx.out = &null_stream;
+	const long long ops = 200000;
+	for (const auto& [name, args] : calls) {
+		if (stdlib.find(name) == stdlib.end()) continue;
+		bench("stdlib " + name, ops, [] {}, [&] {
+			for (long long i = 0; i < ops; i++) {
+				Value result = callFunction(ctx, name, args);
+				asm volatile("" : : "r"(&result) : "memory");
+			}
+		});
+	}
+}
+
+int main(int argc, char *argv[]) {
+	if (argc > 1) filter = argv[1];
+
+	cout << "Median of " << runs << " runs after a warm-up run"
+	     << (counters.available() ? "" : ", hardware counters unavailable (perf_event_open failed)") << ".\n\n";
+	report_header();
+	bench_lexer();
+	bench_token_stream();
+	bench_parse_expression();
+	bench_document();
+	bench_binary_expr();
+	bench_stdlib();
+	return 0;
+}
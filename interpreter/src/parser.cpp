@@ -15,84 +15,27 @@
  */
 #include "parser.h"
 #include "commons.cpp"
-
-struct Token {
-	int line_nb;
-	string line;
-	string value;
-	string type;
-};
-
-/**
- * @class TokenStream
- * @brief A class to handle the tokens generated by the lexer.
- * @note This class stores the raw tokens and the number of tokens per line, and reconstructs lines for error reporting.
- */
-
-class TokenStream {
-public:
-    vector<pair<string, string>> raw_tokens; // {type, value} 
-    vector<Token> tokens; // final token list
-
-    void init(vector<int> tokens_per_line) {
-        /**
-         * @brief Initializes the TokenStream by using tokens_per_line to build each token's line context and number.
-         * @note This function assumes that tokens_per_line aligns exactly with the number of logical lines in the source code.
-         */
-        size_t token_index = 0;
-        int line_number = 1;
-
-        for (int count : tokens_per_line) {
-            vector<string> current_line_texts;
-            string full_line;
-
-            for (int i = 0; i < count; ++i) {
-                if (token_index >= raw_tokens.size()) break;
-
-                auto [type, value] = raw_tokens[token_index++];
-                current_line_texts.push_back(value);
-            }
-
-            full_line = join(current_line_texts, " ");
-
-            for (int i = 0; i < count; ++i) {
-                const auto& [type, value] = raw_tokens[token_index - count + i];
-                tokens.push_back({line_number, full_line, value, type});
-            }
-
-            line_number++;
-        }
-    }
-
-private:
-    std::string join(const std::vector<std::string>& words, const std::string& sep) {
-        std::string result;
-        for (size_t i = 0; i < words.size(); ++i) {
-            result += words[i];
-            if (i + 1 < words.size()) result += sep;
-        }
-        return result;
-    }
-};
-
-
-// ABSTRACT SYNTAX TREE IMPLEMEMTATION
-
-vector<ASTNode*> AST; // vector of AST nodes
-vector<string> parser_variables; // vector of variables
-vector<string> parser_user_defined_fn; // vector of user defined functions
+#include <map>
+#include <set>
 
 // PARSER IMPLEMENTATION
 
 int get_precedence(const string& op) {
-	if (op == "+" || op == "-") return 1;
-	if (op == "*" || op == "/" || op == "%") return 2;
+	/**
+	 * @brief How tightly a binary operator binds, 0 for tokens that are not one (`=`, `++`, `nu`...), which end the expression.
+	 * @note sau < si < comparisons < + - < * / %, so `a < b si b < c sau d` is `((a < b) si (b < c)) sau d`.
+	 */
+	if (op == "sau" || op == "||") return 1;
+	if (op == "si" || op == "&&") return 2;
+	if (find(comparison_operators.begin(), comparison_operators.end(), op) != comparison_operators.end()) return 3;
+	if (op == "+" || op == "-") return 4;
+	if (op == "*" || op == "/" || op == "%") return 5;
 	return 0;
 }
 
-Expr* parse_expression(const vector<Token>& tokens, int& idx);
+static const int not_operand_precedence = 3; // `nu a == b` negates the comparison, like `nu (a == b)`
 
-Expr* parse_primary_expression(const vector<Token>& tokens, int& idx) {
+Expr* Parser::parse_primary_expression(const vector<Token>& tokens, int& idx) {
 
 	/**
  	* @brief Parses the simplest elements of an expression (literals and variable references).
@@ -101,42 +44,29 @@ Expr* parse_primary_expression(const vector<Token>& tokens, int& idx) {
  	* @return The coresponding derived expression.
 	 */
 
-    if (idx >= tokens.size()) return nullptr;
+    if (idx >= static_cast<int>(tokens.size())) return nullptr;
 
-    if (tokens[idx].type == "INT") {
-        int value = stoi(tokens[idx].value);
+    if (token_at(tokens, idx).type == "INT") {
+        int value = stoi(token_at(tokens, idx).value);
         idx++;
         return new IntLiteral(value);
     }
-    else if (tokens[idx].type == "FLOAT") {
-        float value = stof(tokens[idx].value);
+    else if (token_at(tokens, idx).type == "FLOAT") {
+        float value = stof(token_at(tokens, idx).value);
         idx++;
         return new FloatLiteral(value);
     }
-    else if (tokens[idx].type == "STRING") {
-        string value = tokens[idx].value;
+    else if (token_at(tokens, idx).type == "STRING") {
+        string value = token_at(tokens, idx).value;
         idx++;
         return new StringLiteral(value);
     }
-    else if (tokens[idx].type == "ID") {
-        string name = tokens[idx].value;
+    else if (token_at(tokens, idx).type == "ID") {
+        string name = token_at(tokens, idx).value;
         idx++;
-        if (idx < tokens.size() && tokens[idx].type == "LPAREN") {
-        	if (stdlib.find(name) != stdlib.end()) {
-            	idx++;
-            	vector<Expr*> args;
-
-        		while (idx < tokens.size() && tokens[idx].type != "RPAREN") {
-                	args.push_back(parse_expression(tokens,idx));
-                	if (tokens[idx].type == "COMMA") idx++; // consume ',' between args
-            	}
-
-            	if (idx >= tokens.size() || tokens[idx].type != "RPAREN") {
-                	throw std::runtime_error("Expected ')' after function arguments");
-            	}
-            	idx++;
-
-            	return new FunctionCall(name, args);
+        if (idx < static_cast<int>(tokens.size()) && token_at(tokens, idx).type == "LPAREN") {
+        	if (stdlib.find(name) != stdlib.end() || parser_user_defined_fn.contains(name)) {
+            	return parse_call_arguments(name, tokens, idx);
         	} else {
             	throw std::runtime_error("Unknown function: " + name);
         	}
@@ -144,12 +74,37 @@ Expr* parse_primary_expression(const vector<Token>& tokens, int& idx) {
 
     	return new Refrence(name);
     }
-	else if (tokens[idx].type == "LPAREN") {
+    else if (token_at(tokens, idx).type == "KEYWORD" && token_at(tokens, idx).value == "porneste") {
+        idx++; // consume "porneste"
+        if (idx + 1 >= static_cast<int>(tokens.size()) || token_at(tokens, idx).type != "ID" || token_at(tokens, idx + 1).type != "LPAREN" ||
+            !parser_user_defined_fn.contains(token_at(tokens, idx).value)) {
+            throw std::runtime_error("Expected a user defined function call after 'porneste'");
+        }
+        string name = token_at(tokens, idx).value;
+        idx++;
+        return new SpawnExpr(parse_call_arguments(name, tokens, idx));
+    }
+    else if (token_at(tokens, idx).type == "KEYWORD" && token_at(tokens, idx).value == "asteapta") {
+        idx++; // consume "asteapta"
+        Expr* task = parse_primary_expression(tokens, idx);
+        if (!task) {
+            throw std::runtime_error("Expected a task after 'asteapta'");
+        }
+        return new AwaitExpr(task);
+    }
+    else if (token_at(tokens, idx).type == "OP" && (token_at(tokens, idx).value == "nu" || token_at(tokens, idx).value == "!")) {
+        string op = token_at(tokens, idx).value;
+        idx++; // consume "nu"
+        Expr* operand = parse_primary_expression(tokens, idx);
+        if (!operand) throw std::runtime_error("Expected an expression after '" + op + "'");
+        return new NotExpr(parse_rhs_expression(not_operand_precedence, operand, tokens, idx));
+    }
+	else if (token_at(tokens, idx).type == "LPAREN") {
         idx++; // consume (
         Expr* expr = parse_expression(tokens, idx);
-        if (idx >= tokens.size() || tokens[idx].type != "RPAREN") {
-            cerr << "Error: expected ')' after expression" << endl;
-            return nullptr;
+        if (!expr) throw std::runtime_error("Expected an expression after '('");
+        if (idx >= static_cast<int>(tokens.size()) || token_at(tokens, idx).type != "RPAREN") {
+            throw std::runtime_error("Expected ')' after expression");
         }
         idx++; // consume )
         return expr;
@@ -157,7 +112,37 @@ Expr* parse_primary_expression(const vector<Token>& tokens, int& idx) {
     return nullptr;
 }
 
-Expr* parse_rhs_expression(int expr_prec, Expr* lhs, const vector<Token>& tokens, int& idx) {
+FunctionCall* Parser::parse_call_arguments(const string& name, const vector<Token>& tokens, int& idx) {
+	/**
+ 	* @brief Parses the parenthesized arguments of a call.
+ 	* @param name The name of the called function.
+ 	* @param idx The index of the '(' token, left after the ')' token.
+ 	* @return The FunctionCall expression.
+	 */
+	idx++; // consume '('
+	vector<Expr*> args;
+	vector<Span> spans;
+
+	while (idx < static_cast<int>(tokens.size()) && token_at(tokens, idx).type != "RPAREN") {
+		int column = token_at(tokens, idx).column;
+		Expr* arg = parse_expression(tokens,idx);
+		if (!arg) {
+			throw std::runtime_error("Expected an argument in the call of " + name);
+		}
+		args.push_back(arg);
+		spans.push_back({column, token_at(tokens, idx - 1).end_column}); // from the argument's first token to its last
+		if (idx < static_cast<int>(tokens.size()) && token_at(tokens, idx).type == "COMMA") idx++; // consume ',' between args
+	}
+
+	if (idx >= static_cast<int>(tokens.size()) || token_at(tokens, idx).type != "RPAREN") {
+		throw std::runtime_error("Expected ')' after function arguments");
+	}
+	idx++;
+
+	return new FunctionCall(name, args, spans);
+}
+
+Expr* Parser::parse_rhs_expression(int expr_prec, Expr* lhs, const vector<Token>& tokens, int& idx) {
 	/**
  	* @brief Parses right-hand expression.
  	* @param expr_prec The current expression precedence.
@@ -168,58 +153,101 @@ Expr* parse_rhs_expression(int expr_prec, Expr* lhs, const vector<Token>& tokens
  	* @return BinaryExpr combining the left and right expressions.
 	 */
 
-	while (idx < tokens.size()) {
-        if (tokens[idx].type != "OP") return lhs;
-        string op = tokens[idx].value;
+	while (idx < static_cast<int>(tokens.size())) {
+        if (token_at(tokens, idx).type != "OP") return lhs;
+        string op = token_at(tokens, idx).value;
         int prec = get_precedence(op);
 
-        if (prec < expr_prec) break;
+        if (prec == 0 || prec < expr_prec) break;
 
         idx++; // consume operator
         Expr* rhs = parse_primary_expression(tokens, idx);
-        if (!rhs) return nullptr;
+        if (!rhs) throw std::runtime_error("Expected an expression after '" + op + "'");
 
-        while (idx < tokens.size() && tokens[idx].type == "OP" &&
-               get_precedence(tokens[idx].value) >= prec) {
-            rhs = parse_rhs_expression(get_precedence(tokens[idx].value), rhs, tokens, idx);
+        // only a tighter operator takes rhs as its left operand: equal ones group to the left, `a - b - c` is `(a - b) - c`
+        while (idx < static_cast<int>(tokens.size()) && token_at(tokens, idx).type == "OP" &&
+               get_precedence(token_at(tokens, idx).value) > prec) {
+            rhs = parse_rhs_expression(get_precedence(token_at(tokens, idx).value), rhs, tokens, idx);
         }
 
-        lhs = new BinaryExpr(lhs, op, rhs);
+        if (op == "si" || op == "&&") lhs = new LogicalExpr(lhs, "si", rhs);
+        else if (op == "sau" || op == "||") lhs = new LogicalExpr(lhs, "sau", rhs);
+        else lhs = new BinaryExpr(lhs, op, rhs);
     }
 
     return lhs;
 }
 
-Expr* parse_expression(const vector<Token>& tokens, int& idx) {
+Expr* Parser::parse_expression(const vector<Token>& tokens, int& idx) {
 	/**
  	* @brief Parses an expression and returns the corresponding AST node.
  	* @param tokens The tokens to parse.
  	* @param idx The current index in the tokens vector.
  	* @return The parsed expression as an AST node.
 	 */
-	if (idx >= tokens.size()) return nullptr;
+	if (idx >= static_cast<int>(tokens.size())) return nullptr;
 	Expr* left = parse_primary_expression(tokens, idx);
 	if (!left) return nullptr;
 
 	return parse_rhs_expression(0, left, tokens, idx);
 }
 
-vector<ASTNode*> parse_block(vector<Token> tokens, int& idx);
+Expr* Parser::parse_operand(const vector<Token>& tokens, int& idx, const string& after) {
+	/**
+ 	* @brief Parses the expression an operator needs, throwing a syntax error if there is none.
+ 	* @param after The operator, for the message.
+	 */
+	Expr* expr = parse_expression(tokens, idx);
+	if (!expr) throw std::runtime_error("Expected an expression after '" + after + "'");
+	return expr;
+}
 
-void report_error(const string& msg, const string& line, int line_nb) {
+void Parser::report_error(const string& msg, const vector<Token>& tokens, int at, bool warning) {
 	/**
  	* @brief Thows custom syntax errors.
- 	* @param line The line of the error.
- 	* @param line_nb The line number in the source code.
+ 	* @param tokens The tokens being parsed.
+ 	* @param at Index of the token the error was found at; past the end, the error points right after the last token.
+ 	* @param warning The statement could still be parsed, so the parse goes on normally after it.
  	* @return Prints the error message and the line of code.
 	 */
-	cerr << "Syntax Error: " << msg << "\nOn line: ";
-	cout << line_nb << ": ";
-	cout << line;
-	cerr << "\n\n";
+	bool past_end = at >= static_cast<int>(tokens.size());
+	const Token& token = tokens[past_end ? tokens.size() - 1 : max(at, 0)];
+	errors.push_back({token.line_nb, msg, token.line, past_end ? token.end_column : token.column, token.end_column, warning});
+	if (!warning) failed = true;
+	*err << (warning ? "Warning: " : "Syntax Error: ") << msg << "\nOn line: ";
+	*err << token.line_nb << ": ";
+	*err << token.line;
+	*err << "\n\n";
+}
+
+void Parser::synchronize(const vector<Token>& tokens, int& idx, int start) {
+	/**
+ 	* @brief Skips the rest of a statement that failed to parse, so the next one is parsed from its first token.
+ 	* @param start Index of the first token of the failed statement.
+ 	* @note The statement ends after its ';' or after the block it opened; a '}' closing an enclosing block is left to it.
+	 */
+	if (idx > start && idx <= static_cast<int>(tokens.size()) && tokens[idx - 1].type == "NLINE") return; // it ended already
+	idx = max(idx, start);
+	int depth = 0;
+	while (idx < static_cast<int>(tokens.size())) {
+		const string& type = token_at(tokens, idx).type;
+		if (type == "LBRACE") {
+			depth++;
+		} else if (type == "RBRACE") {
+			if (depth == 0) return;
+			if (--depth == 0) {
+				idx++;
+				return;
+			}
+		} else if (type == "NLINE" && depth == 0) {
+			idx++;
+			return;
+		}
+		idx++;
+	}
 }
 
-void parse_variable_declaration(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST) {
+void Parser::parse_variable_declaration(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST) {
 	/**
  	* @brief Parses a variable declaration line.
  	* @param tokens The tokens to parse.
@@ -228,39 +256,37 @@ void parse_variable_declaration(const vector<Token>& tokens, int& idx, vector<AS
  	* @note Because "var" is not a type spefcific keyword, we cannot determine the type of the variable, in case it has no initializer so we add it to the NDT stack (non determined) and relocate it later.
 	 */
 
-	int start_line_nb=tokens[idx].line_nb;
-	string start_line=tokens[idx].line;
 	idx++;
 
-	if (tokens[idx].type != "ID") {
-		report_error("Expected variable name after 'var'", start_line, start_line_nb);
+	if (token_at(tokens, idx).type != "ID") {
+		report_error("Expected variable name after 'var'", tokens, idx);
 		return;
 	}
 
-	string name=tokens[idx].value;
+	string name=token_at(tokens, idx).value;
 	idx++;
 
-	if (idx<tokens.size() && (tokens[idx].type=="NLINE"||tokens[idx].type=="COMMA"||tokens[idx].value==";"||tokens[idx].value==")")) {
+	if (idx<static_cast<int>(tokens.size()) && (token_at(tokens, idx).type=="NLINE"||token_at(tokens, idx).type=="COMMA"||token_at(tokens, idx).value==";"||token_at(tokens, idx).value==")")) {
 		Expr* default_value = new IntLiteral(0);
         ASTNode* node = new VariableDeclaration("NDT", name, default_value);
-		parser_variables.push_back(name); // add variable to the list of variables
+		parser_variables.declare(name); // add variable to the innermost scope
         AST.push_back(node);
 		idx++;
-	} else if (idx<tokens.size()) {
+	} else if (idx<static_cast<int>(tokens.size())) {
 		idx++;
 		Expr* expr = parse_expression(tokens, idx);
 		if (expr) {
 			ASTNode* node = new VariableDeclaration("NDT", name, expr);
-			parser_variables.push_back(name); // add variable to the list of variables
+			parser_variables.declare(name); // add variable to the innermost scope
 			AST.push_back(node);
 			idx++;
 		} else {
-			report_error("Expression parsing failed", start_line, start_line_nb);
+			report_error("Expression parsing failed", tokens, idx);
 		}
 	}
 }
 
-void parse_assignment_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST) {
+void Parser::parse_assignment_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST) {
 	/**
  	* @brief Parses an assignment statement line.
  	* @param tokens The tokens to parse.
@@ -268,90 +294,85 @@ void parse_assignment_statement(const vector<Token>& tokens, int& idx, vector<AS
  	* @return Adds the assignment statement to the AST.
 	 */
 
-	int start_line_nb=tokens[idx].line_nb;
-	string start_line=tokens[idx].line;
-	string name=tokens[idx].value;
+	string name=token_at(tokens, idx).value;
 	idx++; // consume variable name
-	if (tokens[idx].value == "--") {
+	if (token_at(tokens, idx).value == "--") {
 		// handle decrement operator
-		if (parser_variables.empty() || find(parser_variables.begin(), parser_variables.end(), name) == parser_variables.end()) {
-			report_error("Variable '" + name + "' not declared.", start_line, start_line_nb);
+		if (!parser_variables.contains(name)) {
+			report_error("Variable '" + name + "' not declared.", tokens, idx);
 			return;
 		}
-		ASTNode* node = new AssignStatement(new BinaryExpr(new Refrence(name), "-", new IntLiteral(1)), name);
+		ASTNode* node = new UpdateStatement(name, '-', new IntLiteral(1));
 		AST.push_back(node);
 		idx+=2;
 		return;
-	} else if (tokens[idx].value == "++") {
+	} else if (token_at(tokens, idx).value == "++") {
 		// handle increment operator
-		if (parser_variables.empty() || find(parser_variables.begin(), parser_variables.end(), name) == parser_variables.end()) {
-			report_error("Variable '" + name + "' not declared.", start_line, start_line_nb);
+		if (!parser_variables.contains(name)) {
+			report_error("Variable '" + name + "' not declared.", tokens, idx);
 			return;
 		}
-		ASTNode* node = new AssignStatement(new BinaryExpr(new Refrence(name), "+", new IntLiteral(1)), name);
+		ASTNode* node = new UpdateStatement(name, '+', new IntLiteral(1));
 		AST.push_back(node);
 		idx+=2;
 		return;
-	} else if (tokens[idx].value == "+=") {
+	} else if (token_at(tokens, idx).value == "+=") {
 		// handle add operator
-		if (parser_variables.empty() || find(parser_variables.begin(), parser_variables.end(), name) == parser_variables.end()) {
-			report_error("Variable '" + name + "' not declared.", start_line, start_line_nb);
+		if (!parser_variables.contains(name)) {
+			report_error("Variable '" + name + "' not declared.", tokens, idx);
 			return;
 		}
 		idx++; // consume '+=' operator
-		ASTNode* node = new AssignStatement(new BinaryExpr(new Refrence(name), "+", parse_expression(tokens, idx)), name);
+		ASTNode* node = new UpdateStatement(name, '+', parse_operand(tokens, idx, "+="));
 		AST.push_back(node);
 		idx++; // consume new line
 		return;
-	} else if (tokens[idx].value == "-=") {
+	} else if (token_at(tokens, idx).value == "-=") {
 		// handle subtract operator
-		if (parser_variables.empty() || find(parser_variables.begin(), parser_variables.end(), name) == parser_variables.end()) {
-			report_error("Variable '" + name + "' not declared.", start_line, start_line_nb);
+		if (!parser_variables.contains(name)) {
+			report_error("Variable '" + name + "' not declared.", tokens, idx);
 			return;
 		}
 		idx++; // consume '-=' operator
-		ASTNode* node = new AssignStatement(new BinaryExpr(new Refrence(name), "-", parse_expression(tokens, idx)), name);
+		ASTNode* node = new UpdateStatement(name, '-', parse_operand(tokens, idx, "-="));
 		AST.push_back(node);
 		idx++; // consume new line
 		return;
-	} else if (tokens[idx].value == "*=") {
+	} else if (token_at(tokens, idx).value == "*=") {
 		// handle multiply operator
-		if (parser_variables.empty() || find(parser_variables.begin(), parser_variables.end(), name) == parser_variables.end()) {
-			report_error("Variable '" + name + "' not declared.", start_line, start_line_nb);
+		if (!parser_variables.contains(name)) {
+			report_error("Variable '" + name + "' not declared.", tokens, idx);
 			return;
 		}
 		idx++; // consume '*=' operator
-		ASTNode* node = new AssignStatement(new BinaryExpr(new Refrence(name), "*", parse_expression(tokens, idx)), name);
+		ASTNode* node = new UpdateStatement(name, '*', parse_operand(tokens, idx, "*="));
 		AST.push_back(node);
 		idx++; // consume new line
 		return;
-	} else if (tokens[idx].value == "/=") {
+	} else if (token_at(tokens, idx).value == "/=") {
 		// handle divide operator
-		if (parser_variables.empty() || find(parser_variables.begin(), parser_variables.end(), name) == parser_variables.end()) {
-			report_error("Variable '" + name + "' not declared.", start_line, start_line_nb);
+		if (!parser_variables.contains(name)) {
+			report_error("Variable '" + name + "' not declared.", tokens, idx);
 			return;
 		}
 		idx++; // consume '/=' operator
-		ASTNode* node = new AssignStatement(new BinaryExpr(new Refrence(name), "/", parse_expression(tokens, idx)), name);
+		ASTNode* node = new UpdateStatement(name, '/', parse_operand(tokens, idx, "/="));
 		AST.push_back(node);
 		idx++; // consume new line
 		return;
 	}
-	idx++; // consume '=' operator
-
-	if (idx<tokens.size()) {
-		Expr* expr = parse_expression(tokens, idx);
-		ASTNode* node = new AssignStatement(expr, name);
-		AST.push_back(node);
-		idx++;
-		return;
-	} else {
-		report_error("Expected identifier after variable name.", start_line, start_line_nb);
+	if (token_at(tokens, idx).value != "=") {
+		report_error("Expected '=' after '" + name + "'", tokens, idx);
 		return;
 	}
+	idx++; // consume '=' operator
+
+	ASTNode* node = new AssignStatement(parse_operand(tokens, idx, "="), name);
+	AST.push_back(node);
+	idx++;
 }
 
-void parse_fc_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST) {
+void Parser::parse_fc_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST) {
 	/**
  	* @brief Parses an assignment statement line.
  	* @param tokens The tokens to parse.
@@ -359,37 +380,38 @@ void parse_fc_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>&
  	* @return Adds the assignment statement to the AST.
 	 */
 
-	int start_line_nb=tokens[idx].line_nb;
-	string start_line=tokens[idx].line;
-	string name=tokens[idx].value;
+	string name=token_at(tokens, idx).value;
 	idx++; // consume function name
 
-	if (idx<tokens.size() && tokens[idx].type=="LPAREN") {
+	if (idx<static_cast<int>(tokens.size()) && token_at(tokens, idx).type=="LPAREN") {
 		idx++; // consume '('
 		vector<Expr*> args;
-		while (idx < tokens.size() && tokens[idx].type != "RPAREN") {
+		vector<Span> spans;
+		while (idx < static_cast<int>(tokens.size()) && token_at(tokens, idx).type != "RPAREN") {
+			int column = token_at(tokens, idx).column;
 			Expr* arg = parse_expression(tokens, idx);
 			if (arg) {
 				args.push_back(arg);
+				spans.push_back({column, token_at(tokens, idx - 1).end_column});
 			} else {
-				report_error("Expected expression in function call arguments.", start_line, start_line_nb);
+				report_error("Expected expression in function call arguments.", tokens, idx);
 				return;
 			}
-			if (idx < tokens.size() && tokens[idx].type == "COMMA") {
+			if (idx < static_cast<int>(tokens.size()) && token_at(tokens, idx).type == "COMMA") {
 				idx++; // consume ','
 			}
 		}
-		ASTNode* node = new FunctionCall(name, args);
+		ASTNode* node = new FunctionCall(name, args, spans);
 		AST.push_back(node);
 		idx+=2;
 		return;
 	} else {
-		report_error("Expected identifier after variable name.", start_line, start_line_nb);
+		report_error("Expected identifier after variable name.", tokens, idx);
 		return;
 	}
 }
 
-void parse_print_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST) {
+void Parser::parse_print_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST) {
 	/**
  	* @brief Parses a print statement line.
  	* @param tokens The tokens to parse.
@@ -397,24 +419,20 @@ void parse_print_statement(const vector<Token>& tokens, int& idx, vector<ASTNode
  	* @return Adds the print statement to the AST.
 	 */
 
-	int start_line_nb=tokens[idx].line_nb;
-	string start_line=tokens[idx].line;
 	idx++;
 
-	if (idx<tokens.size()) {
+	if (idx<static_cast<int>(tokens.size())) {
 		ASTNode* node = new PrintStatement(parse_expression(tokens, idx));
 		AST.push_back(node);
 		idx++;
 		return;
 	} else {
-		report_error("Expected identifier after 'afiseaza'", start_line, start_line_nb);
+		report_error("Expected identifier after 'afiseaza'", tokens, idx);
 		return;
 	}
 }
 
-vector<ASTNode*> functionDefinitions;
-
-void parse_fd_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST) {
+void Parser::parse_fd_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST) {
 	/**
  	* @brief Parses a function definition statement line.
  	* @param tokens The tokens to parse.
@@ -422,36 +440,121 @@ void parse_fd_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>&
  	* @return Adds the function definition statement to the AST.
 	 */
 
-	int start_line_nb=tokens[idx].line_nb;
-	string start_line=tokens[idx].line;
 	idx++;
 
-	if (idx<tokens.size() && tokens[idx].type=="ID") {
-		string name=tokens[idx].value;
+	if (idx<static_cast<int>(tokens.size()) && token_at(tokens, idx).type=="ID") {
+		string name=token_at(tokens, idx).value;
 		vector<ASTNode*> args, block;
 		idx++;
-		if (tokens[idx].type != "LPAREN"){
-			throw "Expected '(' after function name.";
+		if (idx >= static_cast<int>(tokens.size()) || token_at(tokens, idx).type != "LPAREN"){
+			report_error("Expected '(' after function name.", tokens, idx);
+			return;
 		}
 		idx++;
-		while (idx<tokens.size()){
-			parse_variable_declaration(tokens,idx,args);
-			if (tokens[idx].value!="var") break;
+		if (idx<static_cast<int>(tokens.size()) && token_at(tokens, idx).type=="RPAREN") {
+			idx++; // no parameters
 		}
-		block=parse_block(tokens,idx);
-		ASTNode* node=new FunctionDefinition(name,args,block);
+		bool top_level = parser_variables.depth() == 0; // only there the declarations before it stay the same to the end
+		size_t visible_variables = parser_variables.size();
+		int body = -1;
+		bool starts_tasks = false;
+		parser_variables.open(); // the parameters and the variables of the body are the function's own, like at run time
+		int enclosing_loops = loops;
+		loops = 0; // opreste and continua cannot leave a function
+		try {
+			while (idx<static_cast<int>(tokens.size()) && token_at(tokens, idx-1).type!="RPAREN"){
+				if (token_at(tokens, idx).value!="var") {
+					report_error("Expected 'var' before parameter name", tokens, idx);
+					parser_variables.close();
+					loops = enclosing_loops;
+					return;
+				}
+				parse_variable_declaration(tokens,idx,args); // consumes the ',' or ')' after the parameter
+			}
+			parser_user_defined_fn.declare(name); // known before the body, so the function can call itself
+			if (lazy_functions && top_level) body = skip_body(tokens, idx, starts_tasks);
+			if (body < 0) block = parse_block(tokens, idx);
+		} catch (...) {
+			parser_variables.close();
+			loops = enclosing_loops;
+			throw;
+		}
+		parser_variables.close();
+		loops = enclosing_loops;
+		auto* node = new FunctionDefinition(name, args, block);
+		node->body = body;
+		node->body_end = body < 0 ? -1 : idx;
+		node->visible_variables = visible_variables;
+		node->visible_functions = parser_user_defined_fn.size();
+		node->starts_tasks = starts_tasks;
 		AST.push_back(node);
 		functionDefinitions.push_back(node);
-		parser_user_defined_fn.push_back(name);
 		return;
 	} else {
-		report_error("Expected identifier after 'functie'", start_line, start_line_nb);
+		report_error("Expected identifier after 'functie'", tokens, idx);
+		return;
+	}
+}
+
+
+void Parser::parse_return_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST) {
+	/**
+ 	* @brief Parses a return statement: `returneaza [expresie];`.
+ 	* @param tokens The tokens to parse.
+ 	* @param idx Current token index.
+ 	* @return Adds the return statement to the AST.
+	 */
+
+	idx++; // consume "returneaza"
+	Expr* expr = nullptr;
+	if (idx<static_cast<int>(tokens.size()) && token_at(tokens, idx).type!="NLINE") {
+		expr = parse_expression(tokens, idx);
+	}
+	AST.push_back(new ReturnStatement(expr));
+	idx++; // consume ';'
+}
+
+void Parser::parse_loop_jump_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST) {
+	/**
+ 	* @brief Parses `opreste;` or `continua;`, which only make sense inside a loop of the same function.
+ 	* @param tokens The tokens to parse.
+ 	* @param idx Current token index.
+ 	* @return Adds the break or continue statement to the AST.
+	 */
+
+	string keyword = token_at(tokens, idx).value;
+	if (loops == 0) {
+		report_error("'" + keyword + "' outside a loop", tokens, idx);
+		return;
+	}
+	idx++; // consume the keyword
+	if (token_at(tokens, idx).type != "NLINE") {
+		report_error("Expected ';' after '" + keyword + "'", tokens, idx);
 		return;
 	}
+	idx++; // consume ';'
+	if (keyword == "opreste") AST.push_back(new BreakStatement());
+	else AST.push_back(new ContinueStatement());
 }
 
+void Parser::parse_task_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST) {
+	/**
+ 	* @brief Parses a statement made of a task expression: `porneste f(...);` or `asteapta t;`.
+ 	* @param tokens The tokens to parse.
+ 	* @param idx Current token index.
+ 	* @return Adds the expression to the AST as a statement.
+	 */
 
-void parse_input_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST) {
+	Expr* expr = parse_expression(tokens, idx);
+	if (!expr) {
+		report_error("Expected expression after '" + token_at(tokens, idx).value + "'", tokens, idx);
+		return;
+	}
+	AST.push_back(expr);
+	idx++; // consume ';'
+}
+
+void Parser::parse_input_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST) {
 	/**
  	* @brief Parses a input statement line.
  	* @param tokens The tokens to parse.
@@ -459,22 +562,20 @@ void parse_input_statement(const vector<Token>& tokens, int& idx, vector<ASTNode
  	* @return Adds the input statement to the AST.
 	 */
 
-	int start_line_nb=tokens[idx].line_nb;
-	string start_line=tokens[idx].line;
 	idx++;
 
-	if (idx<tokens.size() && tokens[idx].type=="ID") {
-		ASTNode* node = new InputStatement(tokens[idx].value);
+	if (idx<static_cast<int>(tokens.size()) && token_at(tokens, idx).type=="ID") {
+		ASTNode* node = new InputStatement(token_at(tokens, idx).value);
 		AST.push_back(node);
 		idx+=2;
 		return;
 	} else {
-		report_error("Expected identifier after 'citeste'", start_line, start_line_nb);
+		report_error("Expected identifier after 'citeste'", tokens, idx);
 		return;
 	}
 }
 
-void parse_for_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST) {
+void Parser::parse_for_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST) {
 	/**
  	* @brief Parses a for statement line.
  	* @param tokens The tokens to parse.
@@ -482,12 +583,15 @@ void parse_for_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>
  	* @return Adds the for statement to the AST.
 	 */
 
-	int start_line_nb=tokens[idx].line_nb;
-	string start_line=tokens[idx].line;
+	if (idx+1<static_cast<int>(tokens.size()) && token_at(tokens, idx+1).value == "fiecare") {
+		parse_foreach_statement(tokens, idx, AST);
+		return;
+	}
+
 	idx++; // consume "pentru"
 
-	if (tokens[idx].type != "LPAREN") {
-		report_error("Expected '(' after 'pentru'", start_line, start_line_nb);
+	if (token_at(tokens, idx).type != "LPAREN") {
+		report_error("Expected '(' after 'pentru'", tokens, idx);
 		return;
 	}
 
@@ -496,43 +600,261 @@ void parse_for_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>
 	vector<ASTNode*> init_block; // initialization block
 	Expr* condition = nullptr; // loop condition
 
-	if (tokens[idx].type == "KEYWORD" && tokens[idx].value == "var") {
+	if (token_at(tokens, idx).type == "KEYWORD" && token_at(tokens, idx).value == "var") {
 		parse_variable_declaration(tokens, idx, init_block); // parse variable declaration
-	} else if (tokens[idx].type == "ID") {
+	} else if (token_at(tokens, idx).type == "ID") {
 		parse_assignment_statement(tokens, idx, init_block); // parse assignment statement
 	} else {
-		report_error("Expected variable declaration or assignment after 'pentru ('", start_line, start_line_nb);
+		report_error("Expected variable declaration or assignment after 'pentru ('", tokens, idx);
 		return;
 	}
 
-	condition = parse_expression(tokens, idx); // parse loop condition
+	condition = parse_operand(tokens, idx, ";"); // parse loop condition
 	
-	if (tokens[idx].value == ";"){
+	if (token_at(tokens, idx).value == ";"){
 		idx++; // consume ';'
 	} else {
-		report_error("Expected ';' after loop condition", start_line, start_line_nb);
+		report_error("Expected ';' after loop condition", tokens, idx);
 		return;
 	}
 
-	if (tokens[idx].type == "ID") {
+	if (token_at(tokens, idx).type == "ID") {
 		parse_assignment_statement(tokens, idx, init_block); // parse assignment statement
 	} else {
-		report_error("Expected variable declaration or assignment after 'pentru ('", start_line, start_line_nb);
+		report_error("Expected variable declaration or assignment after 'pentru ('", tokens, idx);
 		return;
 	}
 
-	vector<ASTNode*> block = parse_block(tokens, idx); // main for block
+	vector<ASTNode*> block = parse_loop_block(tokens, idx); // main for block
 	if (block.empty()) {
-		report_error("Expected block after 'pentru (...)'", start_line, start_line_nb);
+		report_error("Expected block after 'pentru (...)'", tokens, idx);
 		return;
 	}
 
+	if (init_block.size() != 2) return; // the initialization or the step did not parse, it was reported
 	ASTNode* node = new ForStatement(init_block[0], condition, block, init_block[1]);
 	AST.push_back(node);
 	return;
 }
 
-void parse_while_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST) {
+/**
+ * @struct ParallelCheck
+ * @brief What the parallel loop check learned about a block.
+ */
+struct ParallelCheck {
+	set<string> locals; // variables declared inside the loop, plus the loop variable
+	set<string> reads; // variables read from outside the loop (reduction updates excluded)
+	map<string, string> reductions; // reduction target -> operator family
+	string reason; // why the loop cannot run in parallel, empty if it can
+	int loops = 0; // loops nested in the parallel one around the statement checked, which an opreste only leaves
+};
+
+static void collect_reads(Expr* expr, ParallelCheck& check) {
+	/**
+	 * @brief Records the variables an expression reads and rejects calls with side effects.
+	 */
+	if (!expr) return;
+	if (auto ref = dynamic_cast<Refrence*>(expr)) {
+		if (!check.locals.count(ref->name)) check.reads.insert(ref->name);
+	} else if (auto bin = dynamic_cast<BinaryExpr*>(expr)) {
+		collect_reads(bin->left, check);
+		collect_reads(bin->right, check);
+	} else if (auto neg = dynamic_cast<NotExpr*>(expr)) {
+		collect_reads(neg->operand, check);
+	} else if (auto fc = dynamic_cast<FunctionCall*>(expr)) {
+		if (fc->name == "afiseaza" || fc->name == "citeste" || stdlib.find(fc->name) == stdlib.end()) {
+			if (check.reason.empty()) check.reason = "it calls '" + fc->name + "'";
+		}
+		for (Expr* arg : fc->args) collect_reads(arg, check);
+	} else if (dynamic_cast<SpawnExpr*>(expr) || dynamic_cast<AwaitExpr*>(expr)) {
+		if (check.reason.empty()) check.reason = "it starts or waits for tasks";
+	}
+}
+
+static void check_parallel_block(const vector<ASTNode*>& block, ParallelCheck& check) {
+	/**
+	 * @brief Walks a loop body and classifies every write as loop-local or as a reduction.
+	 */
+	for (ASTNode* node : block) {
+		if (!check.reason.empty()) return;
+		if (auto decl = dynamic_cast<VariableDeclaration*>(node)) {
+			collect_reads(decl->value, check);
+			if (check.reads.count(decl->name)) {
+				check.reason = "'" + decl->name + "' is read before it is declared";
+			}
+			check.locals.insert(decl->name);
+		} else if (auto assign = dynamic_cast<AssignStatement*>(node)) {
+			if (check.locals.count(assign->name)) {
+				collect_reads(assign->expr, check);
+				continue;
+			}
+			auto bin = dynamic_cast<BinaryExpr*>(assign->expr);
+			auto target = bin ? dynamic_cast<Refrence*>(bin->left) : nullptr;
+			if (!target || target->name != assign->name || (bin->op != "+" && bin->op != "-" && bin->op != "*")) {
+				check.reason = "it writes the shared variable '" + assign->name + "'";
+				return;
+			}
+			string family = bin->op == "*" ? "*" : "+";
+			auto known = check.reductions.find(assign->name);
+			if (known != check.reductions.end() && known->second != family) {
+				check.reason = "'" + assign->name + "' is both added to and multiplied";
+				return;
+			}
+			check.reductions[assign->name] = family;
+			collect_reads(bin->right, check);
+		} else if (auto update = dynamic_cast<UpdateStatement*>(node)) {
+			collect_reads(update->expr, check);
+			if (check.locals.count(update->name)) continue;
+			if (update->op == '/') {
+				check.reason = "it writes the shared variable '" + update->name + "'";
+				return;
+			}
+			string family = update->op == '*' ? "*" : "+";
+			auto known = check.reductions.find(update->name);
+			if (known != check.reductions.end() && known->second != family) {
+				check.reason = "'" + update->name + "' is both added to and multiplied";
+				return;
+			}
+			check.reductions[update->name] = family;
+		} else if (auto fc = dynamic_cast<FunctionCall*>(node)) {
+			collect_reads(fc, check);
+		} else if (auto ifs = dynamic_cast<IfStatement*>(node)) {
+			collect_reads(ifs->expr, check);
+			check_parallel_block(ifs->block, check);
+			for (auto& branch : ifs->elseIfBranches) {
+				collect_reads(branch.first, check);
+				check_parallel_block(branch.second, check);
+			}
+			check_parallel_block(ifs->elseBlock, check);
+		} else if (auto whileStmt = dynamic_cast<WhileStatement*>(node)) {
+			collect_reads(whileStmt->expr, check);
+			check.loops++;
+			check_parallel_block(whileStmt->block, check);
+			check.loops--;
+		} else if (auto doWhileStmt = dynamic_cast<DoWhileStatement*>(node)) {
+			check.loops++;
+			check_parallel_block(doWhileStmt->block, check);
+			check.loops--;
+			collect_reads(doWhileStmt->expr, check);
+		} else if (auto doUntilStmt = dynamic_cast<DoUntilStatement*>(node)) {
+			check.loops++;
+			check_parallel_block(doUntilStmt->block, check);
+			check.loops--;
+			collect_reads(doUntilStmt->expr, check);
+		} else if (auto forStmt = dynamic_cast<ForStatement*>(node)) {
+			check_parallel_block({forStmt->init_block}, check);
+			collect_reads(forStmt->expr, check);
+			check.loops++;
+			check_parallel_block(forStmt->block, check);
+			check.loops--;
+			check_parallel_block({forStmt->assign_block}, check);
+		} else if (auto forEach = dynamic_cast<ForEachStatement*>(node)) {
+			collect_reads(forEach->sequence, check);
+			collect_reads(forEach->start, check);
+			collect_reads(forEach->end, check);
+			collect_reads(forEach->step, check);
+			check.locals.insert(forEach->name);
+			check.loops++;
+			check_parallel_block(forEach->block, check);
+			check.loops--;
+		} else if (auto sw = dynamic_cast<SwitchStatement*>(node)) {
+			collect_reads(sw->expr, check);
+			for (auto& c : sw->cases) check_parallel_block(c.second, check);
+			check_parallel_block(sw->elseBlock, check);
+		} else if (dynamic_cast<BreakStatement*>(node)) {
+			// which iterations would have run is not known in advance, unless it only leaves a nested loop
+			if (check.loops == 0) check.reason = "it may stop early with 'opreste'";
+		} else if (dynamic_cast<ContinueStatement*>(node)) {
+			// ends one iteration, the other iterations are unaffected
+		} else {
+			check.reason = "it contains a statement with side effects";
+		}
+	}
+}
+
+void Parser::parse_foreach_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST) {
+	/**
+ 	* @brief Parses a for each statement: `pentru fiecare [paralel] x din interval(a, b[, pas]) { ... }` or `pentru fiecare c din sir { ... }`.
+ 	* @param tokens The tokens to parse.
+ 	* @param idx Current token index.
+ 	* @return Adds the for each statement to the AST.
+ 	* @note A `paralel` loop whose block is not safe to split is reported and kept sequential.
+	 */
+
+	int first = idx;
+	idx+=2; // consume "pentru fiecare"
+
+	bool parallel = false;
+	if (idx<static_cast<int>(tokens.size()) && token_at(tokens, idx).value == "paralel") {
+		parallel = true;
+		idx++; // consume "paralel"
+	}
+
+	if (idx>=static_cast<int>(tokens.size()) || token_at(tokens, idx).type != "ID") {
+		report_error("Expected variable name after 'pentru fiecare'", tokens, idx);
+		return;
+	}
+	string name = token_at(tokens, idx).value;
+	idx++;
+
+	if (idx>=static_cast<int>(tokens.size()) || token_at(tokens, idx).value != "din") {
+		report_error("Expected 'din' after the loop variable", tokens, idx);
+		return;
+	}
+	idx++; // consume "din"
+
+	Expr *sequence = nullptr, *start = nullptr, *end = nullptr, *step = nullptr;
+	if (idx+1<static_cast<int>(tokens.size()) && token_at(tokens, idx).value == "interval" && token_at(tokens, idx+1).type == "LPAREN") {
+		idx+=2; // consume "interval("
+		start = parse_expression(tokens, idx);
+		if (idx<static_cast<int>(tokens.size()) && token_at(tokens, idx).type == "COMMA") {
+			idx++; // consume ','
+			end = parse_expression(tokens, idx);
+		}
+		if (idx<static_cast<int>(tokens.size()) && token_at(tokens, idx).type == "COMMA") {
+			idx++; // consume ','
+			step = parse_expression(tokens, idx);
+		}
+		if (!start || !end || idx>=static_cast<int>(tokens.size()) || token_at(tokens, idx).type != "RPAREN") {
+			report_error("Expected 'interval(start, end[, step])'", tokens, idx);
+			return;
+		}
+		idx++; // consume ')'
+	} else {
+		sequence = parse_expression(tokens, idx);
+		if (!sequence) {
+			report_error("Expected a string or 'interval(...)' after 'din'", tokens, idx);
+			return;
+		}
+	}
+
+	parser_variables.declare(name); // the loop variable is declared by the loop
+
+	vector<ASTNode*> block = parse_loop_block(tokens, idx); // main for each block
+	ForEachStatement* node = new ForEachStatement(name, sequence, start, end, step, block, parallel);
+
+	if (parallel) {
+		ParallelCheck check;
+		check.locals.insert(name);
+		check_parallel_block(block, check);
+		for (const auto& [target, family] : check.reductions) {
+			if (check.reason.empty() && (check.reads.count(target) || check.locals.count(target))) {
+				check.reason = "the reduction target '" + target + "' is also read or declared in the loop";
+			}
+		}
+		if (check.reason.empty()) {
+			node->reductions.assign(check.reductions.begin(), check.reductions.end());
+			node->locals = {name};
+		} else {
+			report_error("'paralel' loop runs sequentially because " + check.reason, tokens, first, true);
+			node->parallel = false;
+		}
+	}
+
+	AST.push_back(node);
+}
+
+void Parser::parse_while_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST) {
 	/**
  	* @brief Parses a while statement line.
  	* @param tokens The tokens to parse.
@@ -540,30 +862,28 @@ void parse_while_statement(const vector<Token>& tokens, int& idx, vector<ASTNode
  	* @return Adds the while statement to the AST.
 	 */
 
-	int start_line_nb=tokens[idx].line_nb;
-	string start_line=tokens[idx].line;
 	idx++; // cat keyword
 
-	if (tokens[idx].value == "timp") { // support for "timp" keyword
+	if (token_at(tokens, idx).value == "timp") { // support for "timp" keyword
 		idx++; // consume "timp"
 	}
 
-	if (idx<tokens.size() && tokens[idx].type=="LPAREN") {
-		Expr* condition = parse_expression(tokens, idx);
-		if (tokens[idx].value=="executa"){ // support for "executa" keyword
+	if (idx<static_cast<int>(tokens.size()) && token_at(tokens, idx).type=="LPAREN") {
+		Expr* condition = parse_operand(tokens, idx, "cat");
+		if (token_at(tokens, idx).value=="executa"){ // support for "executa" keyword
 			idx++; // consume "executa"
 		}
-		vector<ASTNode*> block = parse_block(tokens, idx); // main while block
+		vector<ASTNode*> block = parse_loop_block(tokens, idx); // main while block
 		ASTNode* node = new WhileStatement(condition, block);
 		AST.push_back(node);
 		return;
 	} else {
-		report_error("Expected '(' after 'cat'/'cat timp'", start_line, start_line_nb);
+		report_error("Expected '(' after 'cat'/'cat timp'", tokens, idx);
 		return;
 	}
 }
 
-void parse_do_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST) {
+void Parser::parse_do_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST) {
 	/**
  	* @brief Parses a do while/until statement line.
  	* @param tokens The tokens to parse.
@@ -571,42 +891,40 @@ void parse_do_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>&
  	* @return Adds the do while/until statement to the AST.
 	 */
 
-	int start_line_nb=tokens[idx].line_nb;
-	string start_line=tokens[idx].line;
 	idx++; // repeta keyword
 
 	vector<ASTNode*> block; // main do while block
-	block = parse_block(tokens, idx); // parse the block
+	block = parse_loop_block(tokens, idx); // parse the block
 	if (block.empty()) {
-		report_error("Expected block after 'repeta'", start_line, start_line_nb);
+		report_error("Expected block after 'repeta'", tokens, idx);
 		return;
 	}
 
-	if (tokens[idx].value == "cat") { // support for "cat" keyword
+	if (token_at(tokens, idx).value == "cat") { // support for "cat" keyword
 		idx++; // consume "cat"
-		if (tokens[idx].value == "timp") { // support for "timp" keyword
+		if (token_at(tokens, idx).value == "timp") { // support for "timp" keyword
 			idx++; // consume "timp"
 		}
-		Expr* condition = parse_expression(tokens, idx);
+		Expr* condition = parse_operand(tokens, idx, "cat");
 		ASTNode* node = new DoWhileStatement(condition, block);
 		AST.push_back(node);
 		return;
-	} else if (tokens[idx].value == "pana") { // support for "pana" keyword
+	} else if (token_at(tokens, idx).value == "pana") { // support for "pana" keyword
 		idx++; // consume "pana"
-		if (tokens[idx].value == "cand") { // support for "cand" keyword
+		if (token_at(tokens, idx).value == "cand") { // support for "cand" keyword
 			idx++; // consume "cand"
 		}
-		Expr* condition = parse_expression(tokens, idx);
+		Expr* condition = parse_operand(tokens, idx, "pana");
 		ASTNode* node = new DoUntilStatement(condition, block);
 		AST.push_back(node);
 		return;
 	} else {
-		report_error("Expected 'cat' or 'pana' after 'repeta'", start_line, start_line_nb);
+		report_error("Expected 'cat' or 'pana' after 'repeta'", tokens, idx);
 		return;
 	}
 }
 
-void parse_if_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST) {
+void Parser::parse_if_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST) {
 	/**
  	* @brief Parses an if statement line.
  	* @param tokens The tokens to parse.
@@ -614,13 +932,11 @@ void parse_if_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>&
  	* @return Adds the if statement to the AST.
 	 */
 
-	int start_line_nb=tokens[idx].line_nb;
-	string start_line=tokens[idx].line;
 	idx++;
 
-	if (idx<tokens.size() && tokens[idx].type=="LPAREN") {
-		Expr* condition = parse_expression(tokens, idx);
-		if (tokens[idx].value=="atunci"){ // support for "atunci" keyword
+	if (idx<static_cast<int>(tokens.size()) && token_at(tokens, idx).type=="LPAREN") {
+		Expr* condition = parse_operand(tokens, idx, "daca");
+		if (token_at(tokens, idx).value=="atunci"){ // support for "atunci" keyword
 			idx++; // consume "atunci"
 		}
 
@@ -628,29 +944,29 @@ void parse_if_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>&
 		vector<ASTNode*> else_block; // else block
 		vector<pair<Expr*, vector<ASTNode*>>> elseif_branches; // else if branches
 
-		while (idx < tokens.size() && tokens[idx].type == "KEYWORD" && tokens[idx].value == "altfel") {
+		while (idx < static_cast<int>(tokens.size()) && token_at(tokens, idx).type == "KEYWORD" && token_at(tokens, idx).value == "altfel") {
 			idx++; // consume "altfel"
-			if (idx < tokens.size() && tokens[idx].value == "daca") {
+			if (idx < static_cast<int>(tokens.size()) && token_at(tokens, idx).value == "daca") {
 				idx++; // consume "daca"
-				Expr* elseif_condition = parse_expression(tokens, idx);
-				if (tokens[idx].value == "atunci") { // support for "atunci" keyword
+				Expr* elseif_condition = parse_operand(tokens, idx, "altfel daca");
+				if (token_at(tokens, idx).value == "atunci") { // support for "atunci" keyword
 					idx++; // consume "atunci"
 				}
 				vector<ASTNode*> elseif_block = parse_block(tokens, idx);
 				elseif_branches.push_back({elseif_condition, elseif_block});
 			} else {
-				if (tokens[idx].type == "LBRACE") {
+				if (token_at(tokens, idx).type == "LBRACE") {
 					else_block = parse_block(tokens, idx); // else block
-				} else if (tokens[idx].value == "atunci") {
+				} else if (token_at(tokens, idx).value == "atunci") {
 					idx++; // consume "atunci"
-					if (tokens[idx].type == "LBRACE") {
+					if (token_at(tokens, idx).type == "LBRACE") {
 						else_block = parse_block(tokens, idx); // else block
 					} else {
-						report_error("Expected '{' after 'altfel atunci'", start_line, start_line_nb);
+						report_error("Expected '{' after 'altfel atunci'", tokens, idx);
 						return;
 					}
 				} else {
-					report_error("Expected '{' after 'altfel'", start_line, start_line_nb);
+					report_error("Expected '{' after 'altfel'", tokens, idx);
 					return;
 				}
 			}
@@ -661,55 +977,183 @@ void parse_if_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>&
 	}
 }
 
+void Parser::parse_switch_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST) {
+	/**
+ 	* @brief Parses a switch statement: `alege (expresie) { caz 1, 2 { ... } caz "a" { ... } altfel { ... } }`.
+ 	* @param tokens The tokens to parse.
+ 	* @param idx Current token index.
+ 	* @return Adds the switch statement to the AST.
+ 	* @note A label is an int (optionally negative) or a string literal, and may appear only once.
+	 */
+
+	idx++; // consume "alege"
+	if (token_at(tokens, idx).type != "LPAREN") {
+		report_error("Expected '(' after 'alege'", tokens, idx);
+		return;
+	}
+	Expr* subject = parse_operand(tokens, idx, "alege");
+	if (token_at(tokens, idx).type != "LBRACE") {
+		delete subject;
+		report_error("Expected '{' after 'alege (...)'", tokens, idx);
+		return;
+	}
+	idx++; // consume '{'
+
+	SwitchStatement* node = new SwitchStatement(subject);
+	set<pair<int, string>> seen; // the labels so far: (1, text) for a string, (0, digits) for an int
+	bool has_else = false;
+	while (token_at(tokens, idx).type != "RBRACE") {
+		const Token& token = token_at(tokens, idx);
+		string error;
+		if (token.type == "KEYWORD" && token.value == "caz") {
+			idx++; // consume "caz"
+			vector<Value> labels;
+			while (error.empty()) {
+				bool negative = token_at(tokens, idx).value == "-" && token_at(tokens, idx + 1).type == "INT";
+				if (negative) idx++; // consume '-'
+				const Token& label = token_at(tokens, idx);
+				if (label.type == "INT") {
+					int value = stoi(label.value);
+					labels.push_back(negative ? -value : value);
+				} else if (label.type == "STRING") {
+					labels.push_back(label.value);
+				} else {
+					error = "Expected an integer or string label after 'caz'";
+					break;
+				}
+				pair<int, string> key = holds_alternative<int>(labels.back()) ? make_pair(0, to_string(get<int>(labels.back()))) : make_pair(1, label.value);
+				if (!seen.insert(key).second) {
+					error = "Label " + (key.first ? "\"" + key.second + "\"" : key.second) + " appears twice in 'alege'";
+					break;
+				}
+				idx++; // consume the label
+				if (token_at(tokens, idx).type != "COMMA") break;
+				idx++; // consume ','
+			}
+			if (error.empty()) {
+				if (token_at(tokens, idx).type == "LBRACE") node->cases.push_back({move(labels), parse_block(tokens, idx)});
+				else error = "Expected '{' after the labels of 'caz'";
+			}
+		} else if (token.type == "KEYWORD" && token.value == "altfel" && !has_else) {
+			idx++; // consume "altfel"
+			if (token_at(tokens, idx).type == "LBRACE") {
+				node->elseBlock = parse_block(tokens, idx);
+				has_else = true;
+			} else {
+				error = "Expected '{' after 'altfel'";
+			}
+		} else {
+			error = token.value == "altfel" ? "'alege' has a single 'altfel'" : "Expected 'caz', 'altfel' or '}' in 'alege'";
+		}
+
+		if (!error.empty()) {
+			report_error(error, tokens, idx);
+			delete node;
+			// skip the rest of the statement, its '}' included, so the statements after it parse from their start
+			for (int depth = 1; idx < static_cast<int>(tokens.size()) && depth > 0; idx++) {
+				if (token_at(tokens, idx).type == "LBRACE") depth++;
+				else if (token_at(tokens, idx).type == "RBRACE") depth--;
+			}
+			failed = false;
+			return;
+		}
+	}
+	idx++; // consume '}'
+	AST.push_back(node);
+}
+
 // Start of the parser function
 
-vector<ASTNode*> parse(vector<pair<string, string>> tokens, vector<int> tokens_per_line) {
+vector<ASTNode*> Parser::parse(vector<pair<string, string>> tokens, vector<int> tokens_per_line, vector<Span> spans) {
 	/**
  	* @brief Parses the tokens and creates the AST.
  	* @param tokens The tokens to parse.
+ 	* @param spans The columns of the tokens, if the lexer gave them; the errors then point at the token, not only the line.
  	* @return The AST.
  	* @note This function is the main entry point for the parser. It takes the tokens generated by the lexer and creates the AST.
 	 */
 
 	TokenStream stream;
-	stream.raw_tokens = tokens; //the only place where we use the raw tokens
-	stream.init(tokens_per_line);
+	memory_line(0); // the token stream belongs to no line, whatever tokenized last
+	{
+		MemScope scope(MemCategory::TOKENS);
+		stream.raw_tokens = move(tokens); //the only place where we use the raw tokens
+		stream.spans = move(spans);
+		stream.init(tokens_per_line);
+	}
 
+	MemScope scope(MemCategory::AST);
 	int idx = 0; // token counter
 
-	while (idx<stream.tokens.size()){
-		string& type=stream.tokens[idx].type;
-		string& value=stream.tokens[idx].value;
+	while (idx<static_cast<int>(stream.tokens.size())){
+		parse_statement(stream.tokens, idx, AST);
+	}
+	memory_line(0);
+	if (lazy_functions) lazy_tokens = move(stream.tokens); // the skipped bodies point into them
+
+	return AST;
+}
+
+void Parser::parse_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST) {
+	/**
+ 	* @brief Parses the statement starting at idx, appending its nodes to AST.
+ 	* @note Every call consumes at least one token. A statement with a syntax error is skipped up to its end (see synchronize),
+ 	* so one parse reports the errors of every statement instead of stopping at the first one.
+	 */
+	size_t first = AST.size();
+	int start = idx;
+	int line = token_at(tokens, idx).line_nb;
+	bool enclosing_failed = failed; // the statement this one is nested in
+	failed = false;
+	memory_line(line);
+	const string& type=token_at(tokens, idx).type;
+	const string& value=token_at(tokens, idx).value;
+	try {
 		if (type == "KEYWORD" && value == "var") {
-			parse_variable_declaration(stream.tokens, idx, AST); // parse variable declaration
+			parse_variable_declaration(tokens, idx, AST); // parse variable declaration
 		/*} else if (type == "KEYWORD" && value == "afiseaza") {
-			parse_print_statement(stream.tokens, idx, AST); // parse print statement
+			parse_print_statement(tokens, idx, AST); // parse print statement
 		} else if (type == "KEYWORD" && value == "citeste") {
-			parse_input_statement(stream.tokens, idx, AST); // parse print statement */
-		} else if (type == "ID" && find(parser_variables.begin(),parser_variables.end(),value)!= parser_variables.end()) {
-			parse_assignment_statement(stream.tokens, idx, AST); // parse assignment statement
-		} else if (type == "ID" && (stdlib.find(value) != stdlib.end()||find(parser_user_defined_fn.begin(),parser_user_defined_fn.end(),value)!=parser_user_defined_fn.end())) {
-			parse_fc_statement(stream.tokens, idx, AST); // parse FunctionCall statement
+			parse_input_statement(tokens, idx, AST); // parse print statement */
+		} else if (type == "ID" && parser_variables.contains(value)) {
+			parse_assignment_statement(tokens, idx, AST); // parse assignment statement
+		} else if (type == "ID" && (stdlib.find(value) != stdlib.end()||parser_user_defined_fn.contains(value))) {
+			parse_fc_statement(tokens, idx, AST); // parse FunctionCall statement
 		} else if (type == "KEYWORD" && value == "functie") {
-			parse_fd_statement(stream.tokens,idx,AST); // parse FunctionDeclaration statement
+			parse_fd_statement(tokens,idx,AST); // parse FunctionDeclaration statement
 		} else if (type == "KEYWORD" && value == "daca") {
-			parse_if_statement(stream.tokens, idx, AST); // parse if statement
+			parse_if_statement(tokens, idx, AST); // parse if statement
+		} else if (type == "KEYWORD" && value == "alege") {
+			parse_switch_statement(tokens, idx, AST); // parse switch statement
 		} else if (type == "KEYWORD" && value == "cat") {
-			parse_while_statement(stream.tokens, idx, AST); // parse while statement
+			parse_while_statement(tokens, idx, AST); // parse while statement
 		} else if (type == "KEYWORD" && value == "pentru") {
-			parse_for_statement(stream.tokens, idx, AST); // parse for statement
+			parse_for_statement(tokens, idx, AST); // parse for statement
 		} else if (type == "KEYWORD" && value == "repeta") {
-			parse_do_statement(stream.tokens,idx,AST); // parse do statement
+			parse_do_statement(tokens,idx,AST); // parse do statement
+		} else if (type == "KEYWORD" && value == "returneaza") {
+			parse_return_statement(tokens,idx,AST); // parse return statement
+		} else if (type == "KEYWORD" && (value == "opreste" || value == "continua")) {
+			parse_loop_jump_statement(tokens,idx,AST); // parse break/continue statement
+		} else if (type == "KEYWORD" && (value == "porneste" || value == "asteapta")) {
+			parse_task_statement(tokens,idx,AST); // parse spawn/await statement
+		} else if (type == "LBRACE" || type == "RBRACE") {
+			report_error("Unexpected token: " + value, tokens, idx);
+			failed = false; // a stray brace is skipped alone, parse_block counts the braces
+			idx++;
 		} else {
-			report_error("Unexpected token: " + value, stream.tokens[idx].line, stream.tokens[idx].line_nb);
-			idx++; // skip the unexpected token
+			report_error("Unexpected token: " + value, tokens, idx);
 		}
+	} catch (const exception& e) { // the expression parser throws, the statement is reported like the others
+		report_error(e.what(), tokens, idx);
 	}
-
-	return AST;
+	if (failed) synchronize(tokens, idx, start);
+	if (idx == start) idx++;
+	failed = enclosing_failed;
+	for (size_t i = first; i < AST.size(); i++) AST[i]->line = line;
 }
 
-vector<ASTNode*> parse_block(vector<Token> tokens, int& idx) {
+vector<ASTNode*> Parser::parse_block(const vector<Token>& tokens, int& idx) {
 	/**
  	* @brief Parses the tokens and creates the AST for a block of code.
  	* @param idx The current index in the tokens vector.
@@ -717,55 +1161,106 @@ vector<ASTNode*> parse_block(vector<Token> tokens, int& idx) {
  	* @return The AST of the block.
 	 */
 
-	if (idx >= tokens.size() || tokens[idx].type != "LBRACE") {
-		report_error("Expected '{' to start a block", tokens[idx].line, tokens[idx].line_nb);
+	if (idx >= static_cast<int>(tokens.size()) || token_at(tokens, idx).type != "LBRACE") {
+		report_error("Expected '{' to start a block", tokens, idx);
 		return {};
 	}
 	idx++; // consume '{'
 	int ct = 1; // brace counter
 
 	vector<ASTNode*> ASTb; // AST for the block
+	parser_variables.open(); // the variables declared in the block end with it
 
-	while (idx<tokens.size()){
-		string& type=tokens[idx].type;
-		string& value=tokens[idx].value;
-		if (type == "RBRACE") { 
+	while (idx<static_cast<int>(tokens.size())){
+		if (token_at(tokens, idx).type == "RBRACE") {
 			ct--;
+			idx++; // consume '}'
 			if (ct==0) {
-				idx++; // consume '}'
-				return ASTb; // end of block
+				break; // end of block
 			}
-			idx++; // consume '}'
+			continue;
 		}
-		if (type == "LBRACE") {
+		if (token_at(tokens, idx).type == "LBRACE") {
 			ct++;
 		}
-		if (type == "KEYWORD" && value == "var") {
-			parse_variable_declaration(tokens, idx, ASTb); // parse variable declaration
-		/*} else if (type == "KEYWORD" && value == "afiseaza") {
-			parse_print_statement(tokens, idx, ASTb); // parse print statement
-		} else if (type == "KEYWORD" && value == "citeste") {
-			parse_input_statement(tokens, idx, ASTb); // parse input statement */
-		} else if (find(parser_variables.begin(),parser_variables.end(),value)!= parser_variables.end()) {
-			parse_assignment_statement(tokens, idx, ASTb); // parse print statement
-		} else if (type == "ID" && (stdlib.find(value) != stdlib.end()||find(parser_user_defined_fn.begin(),parser_user_defined_fn.end(),value)!=parser_user_defined_fn.end())) {
-			parse_fc_statement(tokens, idx, ASTb); // parse FC statement
-		} else if (type == "KEYWORD" && value == "functie") {
-			parse_fd_statement(tokens,idx,ASTb); // parse FunctionDeclaration statement
-
-		} else if (type == "KEYWORD" && value == "daca") {
-			parse_if_statement(tokens, idx, ASTb); // parse if statement
-		} else if (type == "KEYWORD" && value == "cat") {
-			parse_while_statement(tokens, idx, ASTb); // parse while statement
-		} else if (type == "KEYWORD" && value == "pentru") {
-			parse_for_statement(tokens, idx, ASTb); // parse for statement
-		} else if (type == "KEYWORD" && value == "repeta") {
-			parse_do_statement(tokens, idx, ASTb); // parse do statement
-		} else {
-			report_error("Unexpected token: " + value, tokens[idx].line, tokens[idx].line_nb);
-			idx++; // skip the unexpected token
-		}
+		parse_statement(tokens, idx, ASTb);
 	}
 
+	parser_variables.close();
 	return ASTb;
 }
+
+int Parser::skip_body(const vector<Token>& tokens, int& idx, bool& starts_tasks) {
+	/**
+	 * @brief Lazy parse: moves past a function body by matching its braces, leaving it for parse_body.
+	 * @param starts_tasks Set if the body contains `porneste`.
+	 * @return The index of the body's '{', or -1 if it has to be parsed now: its braces do not match (the errors are reported
+	 * at load time), or it defines a function, which the code after it may call.
+	 */
+	if (token_at(tokens, idx).type != "LBRACE") return -1;
+	int end = idx, depth = 0;
+	do {
+		const Token& token = token_at(tokens, end++);
+		if (token.type == "EOF" || (token.type == "KEYWORD" && token.value == "functie")) return -1;
+		if (token.type == "LBRACE") depth++;
+		else if (token.type == "RBRACE") depth--;
+		else if (token.type == "KEYWORD" && token.value == "porneste") starts_tasks = true;
+	} while (depth > 0);
+	swap(idx, end);
+	return end;
+}
+
+bool Parser::parse_body(FunctionDefinition* func) {
+	/**
+	 * @brief Parses a body a lazy parse skipped, as if in its place: it sees the variables and functions declared before the
+	 * definition, which at the top level are the first ones of the tables, and the parameters.
+	 * @return false if it has syntax errors, reported like the ones found at load time.
+	 */
+	if (func->body < 0) return true;
+	MemScope scope(MemCategory::AST);
+	SymbolTable variables = parser_variables, functions = parser_user_defined_fn;
+	parser_variables.truncate(func->visible_variables);
+	parser_user_defined_fn.truncate(func->visible_functions);
+	parser_variables.open();
+	for (ASTNode* param : func->args) parser_variables.declare(static_cast<VariableDeclaration*>(param)->name);
+	size_t reported = errors.size();
+	int idx = func->body;
+	func->body = -1;
+	loops = 0;
+	failed = false;
+	func->block = parse_block(lazy_tokens, idx);
+	if (errors.size() == reported && idx != func->body_end) {
+		// a statement took the '}' as its end, or stopped before it: eagerly, the body would not have ended at its brace either
+		report_error("Expected the body of '" + func->name + "' to end at its closing brace", lazy_tokens, min(idx, func->body_end - 1));
+	}
+	parser_variables = move(variables);
+	parser_user_defined_fn = move(functions);
+	return none_of(errors.begin() + reported, errors.end(), [](const SyntaxError& e) { return !e.warning; });
+}
+
+vector<ASTNode*> Parser::parse_loop_block(const vector<Token>& tokens, int& idx) {
+	/**
+ 	* @brief Parses the body of a loop, where `opreste` and `continua` are allowed.
+	 */
+	loops++;
+	vector<ASTNode*> block = parse_block(tokens, idx); // reports its errors instead of throwing
+	loops--;
+	return block;
+}
+
+void Parser::reset() {
+	/**
+ 	* @brief Deletes the AST built so far and forgets every declared variable and function.
+	 */
+	for (ASTNode* node : AST) {
+		delete node;
+	}
+	AST.clear();
+	parser_variables.clear();
+	parser_user_defined_fn.clear();
+	functionDefinitions.clear();
+	lazy_tokens.clear();
+	errors.clear();
+	failed = false;
+	loops = 0;
+}
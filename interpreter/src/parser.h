@@ -8,12 +8,15 @@
 
 #pragma once
 #include "stdlib.cpp"
+#include "memory.h"
+#include "lexer.h"
 #include <vector>
 #include <iostream>
 #include <algorithm>
 
 inline vector<string> arithmetic_operators = {"+", "-", "*", "/", "%"};
 inline vector<string> comparison_operators = {"==", "!=", "<", ">", "<=", ">="};
+inline vector<string> logical_operators = {"si", "sau", "nu"}; // also written &&, || and !
 
 inline string variant_to_string(const Value& v) { // used to convert Value to string for printing
 	/**
@@ -38,7 +41,8 @@ class ASTNode {
 	public:
 		virtual ~ASTNode() = default;
 		virtual void get(int indent = 0) const = 0;
-		virtual Value eval() {}; // pure virtual function for evaluation
+		virtual Value eval(Context&) { return 0; } // overridden by the nodes that produce a value
+		int line = 0; // source line of a statement, set by the parser, 0 for nodes inside a statement
 };
 
 /**
@@ -48,12 +52,26 @@ class ASTNode {
  */
 class Expr: public ASTNode {
 	public:
-		Value eval() override { cout<<"Base Expression"; }; // pure virtual function for evaluation
+		Value eval(Context& ctx) override { *ctx.err<<"Base Expression"; return 0; }; // pure virtual function for evaluation
 		virtual void print() const = 0;
 		virtual Expr* clone() const = 0;
 		void get(int indent = 0) const override {}
 };
 
+inline bool condition_to_bool(const Value& conditionValue) {
+	/**
+	 * @brief Whether a value counts as true in a condition: a true bool or a nonzero number. A string never does.
+	 */
+    if (holds_alternative<bool>(conditionValue)) {
+        return get<bool>(conditionValue);
+    } else if (holds_alternative<int>(conditionValue)) {
+        return get<int>(conditionValue) != 0;
+    } else if (holds_alternative<float>(conditionValue)) {
+        return get<float>(conditionValue) != 0.0f;
+    }
+    return false; // default case
+}
+
 // STATEMENTS
 
 /**
@@ -102,6 +120,32 @@ class AssignStatement : public ASTNode {
 		}
 };
 
+/**
+ * @class UpdateStatement
+ * @brief Represents an in-place update of a variable in the AST: `x++`, `x--`, `x += e`, `x -= e`, `x *= e` or `x /= e`.
+ * @note Unlike `x = x + e`, the stored value is changed where it is: no copy of the old value, and a string grows in place.
+ */
+class UpdateStatement : public ASTNode {
+	public:
+		string name;
+		char op; // '+', '-', '*' or '/'
+		Expr* expr; // the operand, 1 for ++ and --
+
+		UpdateStatement(string name, char op, Expr* e) : name(move(name)), op(op), expr(e) {}
+
+		void get(int indent=0) const override {
+			cout << "Update Statement: " << name << " " << op << "= ";
+			expr->get();
+			cout << endl;
+		}
+
+		static void apply(Value& target, char op, const Value& value); // defined after BinaryExpr, its fallback
+
+		~UpdateStatement() {
+			delete expr;
+		}
+};
+
 /**
  * @class IfStatement
  * @brief Represents an if statement in the AST.
@@ -164,6 +208,34 @@ public:
     }
 };
 
+/**
+ * @class SwitchStatement
+ * @brief Represents `alege (expr) { caz 1, 2 { ... } caz 3 { ... } altfel { ... } }` in the AST.
+ * @note The labels are int or string literals, each used once. Only the block of the matching case runs (no fall through),
+ * or the altfel block if none matches. The compiler turns the cases into a jump table, so picking one costs the same
+ * whatever their number.
+ */
+class SwitchStatement : public ASTNode {
+	public:
+		Expr* expr;
+		vector<pair<vector<Value>, vector<ASTNode*>>> cases; // the labels of every case and its block
+		vector<ASTNode*> elseBlock;
+
+		SwitchStatement(Expr* e) : expr(e) {}
+
+		void get(int indent=0) const override {
+			cout << string(indent, ' ') << "Switch Statement: " << cases.size() << " cases" << endl;
+		}
+
+		~SwitchStatement() {
+			delete expr;
+			for (auto& c : cases) {
+				for (auto node : c.second) delete node;
+			}
+			for (auto node : elseBlock) delete node;
+		}
+};
+
 /**
  * @class WhileStatement
  * @brief Represents a while statement in the AST.
@@ -269,6 +341,43 @@ class ForStatement : public ASTNode {
 		}
 };
 
+/**
+* @class ForEachStatement
+* @brief Represents a for each statement (`pentru fiecare`) in the AST.
+* @note The loop either walks the characters of a string (sequence) or an integer range `interval(start, end[, step])`, end excluded.
+* @details A `paralel` loop splits its iterations across threads. The parser only keeps it parallel if the block writes nothing
+* but loop-local variables and reduction targets (variables only updated as `x = x + ...`, `x += ...`, `x -= ...` or `x *= ...`).
+*/
+class ForEachStatement : public ASTNode {
+	public:
+		string name; // the loop variable
+		Expr* sequence; // the iterated string, nullptr for a range
+		Expr *start, *end, *step; // the range bounds, step may be nullptr
+		vector<ASTNode*> block;
+		bool parallel;
+		vector<pair<string, string>> reductions; // reduction target and operator family ("+" or "*")
+		vector<string> locals; // the loop variable, copied back after a `paralel` run (the variables of the block end with it)
+
+		ForEachStatement(string n, Expr* seq, Expr* s, Expr* e, Expr* st, vector<ASTNode*> block, bool parallel)
+			: name(move(n)), sequence(seq), start(s), end(e), step(st), block(block), parallel(parallel) {}
+
+		void get(int indent=0) const override {
+			cout << (parallel ? "Parallel For Each Statement: " : "For Each Statement: ") << name;
+			cout << string(indent + 2, ' ') << "Block:\n";
+        	for (const auto& node : block) {
+            	node->get(indent + 4);
+        	}
+			cout << endl;
+		}
+
+		~ForEachStatement() {
+			delete sequence;
+			delete start;
+			delete end;
+			delete step;
+		}
+};
+
 /**
  * @class InputStatement
  * @brief Represents an input statement in the AST.
@@ -287,55 +396,64 @@ class InputStatement : public ASTNode {
 		}
 };
 
+/**
+ * @class FunctionDefinition
+ * @brief Represents a user defined function (`functie`) in the AST.
+ * @note The parameters are VariableDeclaration nodes, their values are the defaults used when a call passes fewer arguments.
+ * A lazy parse leaves the body for the first call: `block` stays empty until Parser::parse_body fills it.
+ */
 class FunctionDefinition : public ASTNode {
 	public:
 	string name;
 	vector<ASTNode*> args;
 	vector<ASTNode*> block;
+	int body = -1, body_end = -1; // the tokens of a body not parsed yet, from its '{' to after its '}'; body is -1 once it is
+	size_t visible_variables = 0, visible_functions = 0; // the declarations the body sees, the ones made before it
+	bool starts_tasks = false; // the body not parsed yet contains `porneste`
 	FunctionDefinition(string n,vector<ASTNode*> a, vector<ASTNode*> b) : name(move(n)), args(move(a)), block(move(b)) {}
 	void get(int indent=0) const override {}
 };
 
-extern vector<ASTNode*> functionDefinitions;
+/**
+ * @class ReturnStatement
+ * @brief Represents a return statement (`returneaza`) in the AST.
+ * @note The expression is optional, a bare `returneaza;` returns 0.
+ */
+class ReturnStatement : public ASTNode {
+	public:
+		Expr* expr;
 
-inline Value callFunction(const string& name, const vector<Value>& args){
-	auto it = stdlib.find(name);
-    if (it != stdlib.end()) {
-		return it->second(args);
-    }
-	for (const auto& funcDef : functionDefinitions) {
-		if (auto* func = dynamic_cast<FunctionDefinition*>(funcDef)) {
-			if (func->name == name) {
-				// implement function call logic here - for expression evaluation
-			}
+		ReturnStatement(Expr* e) : expr(e) {}
+
+		void get(int indent=0) const override {
+			cout << "Return Statement" << endl;
 		}
-	}
-	throw std::runtime_error("Undefined function: " + name);
-}
 
-class FunctionCall : public Expr {
+		~ReturnStatement() {
+			delete expr;
+		}
+};
+
+/**
+ * @class BreakStatement
+ * @brief Represents `opreste;` in the AST: leaves the innermost loop.
+ */
+class BreakStatement : public ASTNode {
 	public:
-	string name;
-	vector<Expr*> args;
-	FunctionCall(string v, vector<Expr*> a) : name(move(v)), args(move(a)) {}
-    Value eval() override {
-		vector<Value> argValues;
-		for (auto* arg : args) {
-			argValues.push_back(arg->eval());
+		void get(int indent=0) const override {
+			cout << "Break Statement" << endl;
 		}
+};
 
-		return callFunction(name, argValues);
-	}
-	void get(int indent = 0) const override {}
-	Expr* clone() const override {
-    	vector<Expr*> clonedArgs;
-    	for (auto* arg : args) {
-        	clonedArgs.push_back(arg->clone());
-    	}
-    	return new FunctionCall(name, move(clonedArgs));
-	}
-	void print() const override {
-	}
+/**
+ * @class ContinueStatement
+ * @brief Represents `continua;` in the AST: goes on with the next iteration of the innermost loop.
+ */
+class ContinueStatement : public ASTNode {
+	public:
+		void get(int indent=0) const override {
+			cout << "Continue Statement" << endl;
+		}
 };
 
 /**
@@ -375,10 +493,10 @@ class VariableDeclaration : public ASTNode {
  * @brief Represents an integer literal in the AST, derrived from Expr.
  */
 class IntLiteral : public Expr {
-    int value;
 	public:
+    int value;
     IntLiteral(int v) : value(v) {}
-    Value eval() override { return value; }
+    Value eval(Context&) override { return value; }
 	void get(int indent = 0) const override {}
 	Expr* clone() const override {
         return new IntLiteral(value);
@@ -393,10 +511,10 @@ class IntLiteral : public Expr {
  * @brief Represents a boolean literal in the AST, derrived from Expr.
  */
 class BoolLiteral : public Expr {
-    bool value;
 	public:
+    bool value;
     BoolLiteral(bool v) : value(v) {}
-    Value eval() override { return value; }
+    Value eval(Context&) override { return value; }
 	void get(int indent = 0) const override {}
 	Expr* clone() const override {
         return new BoolLiteral(value);
@@ -411,10 +529,10 @@ class BoolLiteral : public Expr {
  * @brief Represents a float literal in the AST, derrived from Expr.
  */
 class FloatLiteral : public Expr {
-    float value;
 	public:
+    float value;
     FloatLiteral(float v) : value(v) {}
-    Value eval() override { return value; }
+    Value eval(Context&) override { return value; }
 	void get(int indent = 0) const override {}
 	Expr* clone() const override {
         return new FloatLiteral(value);
@@ -429,10 +547,10 @@ class FloatLiteral : public Expr {
  * @brief Represents a string literal in the AST, derrived from Expr.
  */
 class StringLiteral : public Expr {
-    string value;
 	public:
+    string value;
     StringLiteral(string v) : value(move(v)) {}
-    Value eval() override { return value; }
+    Value eval(Context&) override { return value; }
 	void get(int indent = 0) const override {}
 	Expr* clone() const override {
         return new StringLiteral(value);
@@ -445,14 +563,14 @@ class StringLiteral : public Expr {
 /**
  * @class Refrence
  * @brief Represents a variable reference in the AST, derrived from Expr.
- * @note This class allows access to variables defined in the global scope.
- * @details It retrieves the value of a variable from the global `variables` map.
+ * @note This class allows access to the variables of the running function call and to the global ones.
+ * @details It retrieves the value of a variable through Context::lookup, locals first.
  */
 class Refrence : public Expr {
-    string name;
 	public:
+    string name;
 	Refrence(string v) : name(move(v)) {}
-    Value eval() override { return variables[name]; }
+    Value eval(Context& ctx) override { return ctx.lookup(name); }
 	void get(int indent = 0) const override {}
 	Expr* clone() const override {
         return new Refrence(name);
@@ -462,18 +580,39 @@ class Refrence : public Expr {
 	}
 };
 
+// Implemented by the executor (interpreter.cpp), which owns the call frames and the tasks.
+Value call_user_function(Context& ctx, const FunctionDefinition* func, const vector<Value>& args);
+int spawn_task(Context& ctx, const FunctionDefinition* func, const vector<Value>& args);
+Value await_task(Context& ctx, int id);
+
+/**
+ * @brief Finds a user defined function by name.
+ * @return The first definition with that name, or nullptr.
+ */
+inline const FunctionDefinition* find_function(const vector<ASTNode*>* functions, const string& name) {
+	if (!functions) return nullptr;
+	for (ASTNode* node : *functions) {
+		auto* func = dynamic_cast<FunctionDefinition*>(node);
+		if (func && func->name == name) return func;
+	}
+	return nullptr;
+}
+
 /**
  * @brief Calls a function from the standard library or user-defined functions.
+ * @param ctx The context of the running script.
  * @param name The name of the function to call.
  * @param args The arguments to pass to the function.
  */
-inline Value callFunction(const string& name, const vector<Value>& args){
+inline Value callFunction(Context& ctx, const string& name, const vector<Value>& args){
 	auto it = stdlib.find(name);
-    if (it == stdlib.end()) {
-        throw std::runtime_error("Undefined function: " + name);
+    if (it != stdlib.end()) {
+		return it->second(ctx, args);
     }
-
-	return it->second(args);
+	if (const FunctionDefinition* func = find_function(ctx.functions, name)) {
+		return call_user_function(ctx, func, args);
+	}
+	throw std::runtime_error("Undefined function: " + name);
 }
 
 /**
@@ -485,14 +624,15 @@ class FunctionCall : public Expr {
 	public:
 	string name;
 	vector<Expr*> args;
-	FunctionCall(string v, vector<Expr*> a) : name(move(v)), args(move(a)) {}
-    Value eval() override {
+	vector<Span> arg_spans; // the columns of every argument on the call's line, empty when the parser had none
+	FunctionCall(string v, vector<Expr*> a, vector<Span> spans = {}) : name(move(v)), args(move(a)), arg_spans(move(spans)) {}
+    Value eval(Context& ctx) override {
 		vector<Value> argValues;
 		for (auto* arg : args) {
-			argValues.push_back(arg->eval());
+			argValues.push_back(arg->eval(ctx));
 		}
 
-		return callFunction(name, argValues);
+		return callFunction(ctx, name, argValues);
 	}
 	void get(int indent = 0) const override {}
 	Expr* clone() const override {
@@ -500,9 +640,70 @@ class FunctionCall : public Expr {
     	for (auto* arg : args) {
         	clonedArgs.push_back(arg->clone());
     	}
-    	return new FunctionCall(name, move(clonedArgs));
+    	return new FunctionCall(name, move(clonedArgs), arg_spans);
+	}
+	void print() const override {
+	}
+};
+
+/**
+ * @class SpawnExpr
+ * @brief Starts a user function as a new task (`porneste f(...)`) and evaluates to the task id.
+ * @note The task only runs once the current one waits (`asteapta`, input) or uses up its time slice.
+ */
+class SpawnExpr : public Expr {
+	public:
+	FunctionCall* call;
+	SpawnExpr(FunctionCall* c) : call(c) {}
+	Value eval(Context& ctx) override {
+		vector<Value> argValues;
+		for (auto* arg : call->args) {
+			argValues.push_back(arg->eval(ctx));
+		}
+		const FunctionDefinition* func = find_function(ctx.functions, call->name);
+		if (!func) {
+			throw std::runtime_error("Undefined function: " + call->name);
+		}
+		return spawn_task(ctx, func, argValues);
+	}
+	void get(int indent = 0) const override {}
+	Expr* clone() const override {
+		return new SpawnExpr(static_cast<FunctionCall*>(call->clone()));
 	}
 	void print() const override {
+		cout << "porneste " << call->name;
+	}
+	~SpawnExpr() {
+		delete call;
+	}
+};
+
+/**
+ * @class AwaitExpr
+ * @brief Waits for a task (`asteapta t`) and evaluates to the value its function returned.
+ * @note As a whole statement or a whole initializer the wait suspends the task; nested deeper inside an expression it runs the other tasks in place until the awaited one is done.
+ */
+class AwaitExpr : public Expr {
+	public:
+	Expr* task;
+	AwaitExpr(Expr* t) : task(t) {}
+	Value eval(Context& ctx) override {
+		Value id = task->eval(ctx);
+		if (!holds_alternative<int>(id)) {
+			throw std::runtime_error("asteapta expects a task");
+		}
+		return await_task(ctx, std::get<int>(id));
+	}
+	void get(int indent = 0) const override {}
+	Expr* clone() const override {
+		return new AwaitExpr(task->clone());
+	}
+	void print() const override {
+		cout << "asteapta ";
+		task->print();
+	}
+	~AwaitExpr() {
+		delete task;
 	}
 };
 
@@ -534,11 +735,25 @@ class BinaryExpr : public Expr {
         return new BinaryExpr(left->clone(), op, right->clone());
     }
 
-	Value eval() override
+	Value eval(Context& ctx) override
 	{
-		Value lval = left->eval();
-		Value rval = right->eval();
+		Value lval = left->eval(ctx);
+		Value rval = right->eval(ctx);
+		if (op == "+" && std::holds_alternative<string>(lval) && std::holds_alternative<string>(rval))
+		{
+			MemScope scope(MemCategory::STRINGS);
+			std::get<string>(lval) += std::get<string>(rval); // lval is already a copy of its own: grow it instead of building a third string
+			return lval;
+		}
+		return apply(op, lval, rval);
+	}
 
+	static Value apply(const string& op, const Value& lval, const Value& rval)
+	{
+		/**
+		 * @brief Applies a binary operator to two already evaluated values.
+		 * @note Shared by eval() and by the runtime when it combines values itself (e.g. parallel loop reductions).
+		 */
 		if (std::holds_alternative<int>(lval) && std::holds_alternative<int>(rval))
 		{
 			if (op == "+")
@@ -547,6 +762,8 @@ class BinaryExpr : public Expr {
 				return std::get<int>(lval) - std::get<int>(rval);
 			if (op == "*")
 				return std::get<int>(lval) * std::get<int>(rval);
+			if ((op == "/" || op == "%") && std::get<int>(rval) == 0)
+				throw std::runtime_error("Division by zero"); // an integer division by zero would kill the process
 			if (op == "/")
 				return std::get<int>(lval) / std::get<int>(rval);
 			if (op == "%")
@@ -619,14 +836,21 @@ class BinaryExpr : public Expr {
 
 		if (std::holds_alternative<string>(lval) && std::holds_alternative<string>(rval))
 		{
-			if (op=="+")
+			if (op=="+") {
+				MemScope scope(MemCategory::STRINGS);
 				return std::get<string>(lval) + std::get<string>(rval);
+			}
 			if (op == "==")
 				return std::get<string>(lval) == std::get<string>(rval);
 			if (op == "!=")
 				return std::get<string>(lval) != std::get<string>(rval);
 		}
 
+		if (op == "si") // both operands already evaluated, as when the checker tries the types; LogicalExpr skips the right one
+			return condition_to_bool(lval) && condition_to_bool(rval);
+		if (op == "sau")
+			return condition_to_bool(lval) || condition_to_bool(rval);
+
 		throw std::runtime_error("Unsupported operation or mismatched types");
 	}
 
@@ -636,4 +860,379 @@ class BinaryExpr : public Expr {
     }
 };
 
-vector<ASTNode*> parse(vector<pair<string, string>> tokens, vector<int> tokens_per_line);
+/**
+ * @class LogicalExpr
+ * @brief Represents `left si right` or `left sau right` in the AST, derrived from BinaryExpr.
+ * @note The right operand is only evaluated when the left one does not decide the result, so `lungime(s) > 0 si f(s)`
+ * never calls f on an empty string. The result is a bool. In a condition the compiler does not evaluate the node at all:
+ * each operand becomes its own conditional jump.
+ */
+class LogicalExpr : public BinaryExpr {
+	public:
+	bool conjunction; // si, else sau
+
+	LogicalExpr(Expr* l, string o, Expr* r) : BinaryExpr(l, move(o), r), conjunction(op == "si") {}
+
+	Expr* clone() const override {
+		return new LogicalExpr(left->clone(), op, right->clone());
+	}
+
+	Value eval(Context& ctx) override {
+		bool lval = condition_to_bool(left->eval(ctx));
+		if (lval != conjunction) return lval; // false si ..., true sau ...
+		return condition_to_bool(right->eval(ctx));
+	}
+};
+
+/**
+ * @class NotExpr
+ * @brief Represents `nu operand` (or `!operand`) in the AST, derrived from Expr.
+ */
+class NotExpr : public Expr {
+	public:
+	Expr* operand;
+
+	NotExpr(Expr* e) : operand(e) {}
+
+	void print() const override {
+		cout << "nu ";
+		operand->print();
+	}
+
+	Expr* clone() const override {
+		return new NotExpr(operand->clone());
+	}
+
+	Value eval(Context& ctx) override {
+		return !condition_to_bool(operand->eval(ctx));
+	}
+
+	~NotExpr() {
+		delete operand;
+	}
+};
+
+/**
+ * @class InlinedCall
+ * @brief A call of a small user function replaced by the compiler with the expression the function returns, derrived from Expr.
+ * @note The arguments are evaluated in order, then the defaults of the parameters left out, and stored in hidden variables of
+ * the caller's scope (`slots`, names no script can use); `body` reads them instead of the parameters. No frame is pushed.
+ * While tracing, the original call runs instead, so the trace still shows it.
+ */
+class InlinedCall : public Expr {
+	public:
+	FunctionCall* call; // the call replaced, whose arguments are evaluated
+	vector<string> slots; // one per parameter of the function
+	vector<Expr*> defaults; // for the parameters after the last argument
+	Expr* body;
+	vector<string> reads; // the variables body and defaults read besides the parameters, all globals of the function
+
+	InlinedCall(FunctionCall* c) : call(c), body(nullptr) {}
+
+	void print() const override {
+		cout << call->name;
+	}
+
+	Expr* clone() const override {
+		auto* copy = new InlinedCall(static_cast<FunctionCall*>(call->clone()));
+		copy->slots = slots;
+		for (Expr* value : defaults) copy->defaults.push_back(value->clone());
+		copy->body = body->clone();
+		copy->reads = reads;
+		return copy;
+	}
+
+	Value eval(Context& ctx) override {
+		if (ctx.tracer) return call->eval(ctx);
+		auto& scope = ctx.locals ? *ctx.locals : ctx.variables;
+		for (size_t i = 0; i < slots.size(); i++) {
+			Value value = i < call->args.size() ? call->args[i]->eval(ctx) : defaults[i - call->args.size()]->eval(ctx);
+			scope[slots[i]] = move(value);
+		}
+		return body->eval(ctx);
+	}
+
+	~InlinedCall() {
+		delete call;
+		for (Expr* value : defaults) delete value;
+		delete body;
+	}
+};
+
+/**
+ * @class InvariantExpr
+ * @brief An expression hoisted out of a loop by the compiler, derrived from Expr: nothing the loop does can change its value.
+ * @note The value is computed the first time it is needed after the loop was entered, and kept in a hidden variable of the
+ * running scope (`slot`, a name no script can use) for the remaining iterations. So every call and task has its own, and the
+ * expression is still evaluated at the point it was written, failing there if it fails.
+ */
+class InvariantExpr : public Expr {
+	public:
+	Expr* expr;
+	string slot;
+
+	InvariantExpr(Expr* e, string s) : expr(e), slot(move(s)) {}
+
+	void print() const override {
+		expr->print();
+	}
+
+	Expr* clone() const override {
+		return new InvariantExpr(expr->clone(), slot);
+	}
+
+	Value eval(Context& ctx) override {
+		auto& scope = ctx.locals ? *ctx.locals : ctx.variables;
+		auto it = scope.find(slot);
+		if (it != scope.end()) return it->second;
+		Value value = expr->eval(ctx);
+		scope.emplace(slot, value);
+		return value;
+	}
+
+	~InvariantExpr() {
+		delete expr;
+	}
+};
+
+inline void UpdateStatement::apply(Value& target, char op, const Value& value) {
+	/**
+	 * @brief Computes `target op value` into target. Same results as BinaryExpr::apply, but int and float operands are
+	 * updated through the variant in place and a string is appended to instead of rebuilt.
+	 */
+	if (int* t = std::get_if<int>(&target)) {
+		if (const int* v = std::get_if<int>(&value)) {
+			switch (op) {
+				case '+': *t += *v; return;
+				case '-': *t -= *v; return;
+				case '*': *t *= *v; return;
+				case '/':
+					if (*v == 0) throw std::runtime_error("Division by zero");
+					*t /= *v;
+					return;
+			}
+		}
+	} else if (float* t = std::get_if<float>(&target)) {
+		const float* f = std::get_if<float>(&value);
+		const int* i = std::get_if<int>(&value);
+		if (f || i) {
+			float v = f ? *f : static_cast<float>(*i);
+			switch (op) {
+				case '+': *t += v; return;
+				case '-': *t -= v; return;
+				case '*': *t *= v; return;
+				case '/': *t /= v; return;
+			}
+		}
+	} else if (string* t = std::get_if<string>(&target)) {
+		if (const string* v = std::get_if<string>(&value); v && op == '+') {
+			MemScope scope(MemCategory::STRINGS);
+			*t += *v;
+			return;
+		}
+	}
+	target = BinaryExpr::apply(string(1, op), target, value);
+}
+
+struct Token {
+	int line_nb;
+	string line;
+	string value;
+	string type;
+	int column = 0, end_column = 0; // the columns [column, end_column) of the token on its line, 0 when the lexer gave none
+};
+
+inline const Token& token_at(const vector<Token>& tokens, int idx) {
+	/**
+	 * @brief The token at idx, or an "EOF" token past the end, so a truncated script is reported instead of read out of bounds.
+	 */
+	static const Token end_of_input{0, "", "", "EOF"};
+	return idx >= 0 && idx < static_cast<int>(tokens.size()) ? tokens[idx] : end_of_input;
+}
+
+/**
+ * @struct SyntaxError
+ * @brief One syntax error reported by the parser, with the span of the token it was found at.
+ */
+struct SyntaxError {
+	int line_nb;
+	string message;
+	string line; // the tokens of the line, joined
+	int column = 0, end_column = 0; // 0-based, end excluded, on line line_nb
+	bool warning = false; // the statement was still parsed, only its meaning differs from what was likely intended
+};
+
+/**
+ * @class TokenStream
+ * @brief A class to handle the tokens generated by the lexer.
+ * @note This class stores the raw tokens and the number of tokens per line, and reconstructs lines for error reporting.
+ */
+
+class TokenStream {
+public:
+    vector<pair<string, string>> raw_tokens; // {type, value} 
+    vector<Span> spans; // the columns of the raw tokens, empty if the lexer was not asked for them
+    vector<Token> tokens; // final token list
+
+    void init(vector<int> tokens_per_line) {
+        /**
+         * @brief Initializes the TokenStream by using tokens_per_line to build each token's line context and number.
+         * @note This function assumes that tokens_per_line aligns exactly with the number of logical lines in the source code.
+         */
+        size_t token_index = 0;
+        int line_number = 1;
+
+        for (int count : tokens_per_line) {
+            vector<string> current_line_texts;
+            string full_line;
+
+            for (int i = 0; i < count; ++i) {
+                if (token_index >= raw_tokens.size()) break;
+
+                auto [type, value] = raw_tokens[token_index++];
+                current_line_texts.push_back(value);
+            }
+
+            full_line = join(current_line_texts, " ");
+
+            for (int i = 0; i < count; ++i) {
+                size_t at = token_index - count + i;
+                const auto& [type, value] = raw_tokens[at];
+                Span span = at < spans.size() ? spans[at] : Span(0, 0);
+                tokens.push_back({line_number, full_line, value, type, span.first, span.second});
+            }
+
+            line_number++;
+        }
+    }
+
+private:
+    std::string join(const std::vector<std::string>& words, const std::string& sep) {
+        std::string result;
+        for (size_t i = 0; i < words.size(); ++i) {
+            result += words[i];
+            if (i + 1 < words.size()) result += sep;
+        }
+        return result;
+    }
+};
+
+/**
+ * @class SymbolTable
+ * @brief The names declared so far in a parse, with hashed lookup and nested scopes (a function body is one).
+ * @note A block is a scope too: like at run time, its variables end with it.
+ * The declarations are also kept in order in a log. Closing a scope drops its part of the log, so outside of any scope
+ * the log holds exactly the visible names, and truncate() takes the table back to an earlier size (a Document re-parsing).
+ */
+class SymbolTable {
+	public:
+		bool contains(const string& name) const { return innermost.count(name) > 0; }
+		size_t size() const { return log.size(); }
+		const vector<string>& names() const { return log; }
+		size_t depth() const { return scopes.size(); }
+
+		void declare(const string& name) {
+			/**
+			 * @brief Declares the name in the innermost scope, shadowing the declarations of the outer ones.
+			 */
+			auto [it, added] = innermost.try_emplace(name, log.size());
+			if (!added) {
+				if (it->second >= opened()) return; // already declared in this scope
+				shadowed.push_back(it->second);
+				it->second = log.size();
+			} else {
+				shadowed.push_back(npos);
+			}
+			log.push_back(name);
+		}
+
+		void open() { scopes.push_back(log.size()); }
+
+		void close() {
+			truncate(scopes.back());
+			scopes.pop_back();
+		}
+
+		void truncate(size_t count) {
+			/**
+			 * @brief Forgets the declarations made after the first count ones.
+			 */
+			while (log.size() > count) {
+				if (shadowed.back() == npos) innermost.erase(log.back());
+				else innermost[log.back()] = shadowed.back();
+				log.pop_back();
+				shadowed.pop_back();
+			}
+		}
+
+		void clear() {
+			log.clear();
+			shadowed.clear();
+			innermost.clear();
+			scopes.clear();
+		}
+
+	private:
+		static constexpr size_t npos = static_cast<size_t>(-1);
+
+		vector<string> log; // every visible declaration, in order
+		vector<size_t> shadowed; // for each declaration, the log index of the one it hides, npos if none
+		unordered_map<string, size_t> innermost; // the log index of the visible declaration of each name
+		vector<size_t> scopes; // the log size when each open scope was opened
+
+		size_t opened() const { return scopes.empty() ? 0 : scopes.back(); }
+};
+
+/**
+ * @class Parser
+ * @brief Builds the AST from the tokens generated by the lexer.
+ * @note All the parser state (the AST, the declared variables and functions) lives in the object, so separate parsers never share anything.
+ * @details The parser owns the nodes it creates and deletes them when it is reset or destroyed.
+ */
+class Parser {
+	public:
+		vector<ASTNode*> AST; // vector of AST nodes
+		SymbolTable parser_variables; // the variables visible at the current point of the parse
+		SymbolTable parser_user_defined_fn; // the user defined functions
+		vector<ASTNode*> functionDefinitions; // the FunctionDefinition nodes, also referenced by the AST
+		ostream* err = &cerr; // where syntax errors are reported
+		vector<SyntaxError> errors; // every syntax error reported since the last reset
+		bool lazy_functions = false; // only match the braces of the function bodies, parse_body parses them when needed
+
+		~Parser() { reset(); }
+
+		vector<ASTNode*> parse(vector<pair<string, string>> tokens, vector<int> tokens_per_line, vector<Span> spans = {});
+		void reset();
+		Expr* parse_expression(const vector<Token>& tokens, int& idx); // public so tools (microbench) can parse a lone expression
+		void parse_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST); // public so a Document can re-parse one statement
+		bool parse_body(FunctionDefinition* func);
+
+	private:
+		Expr* parse_primary_expression(const vector<Token>& tokens, int& idx);
+		Expr* parse_rhs_expression(int expr_prec, Expr* lhs, const vector<Token>& tokens, int& idx);
+		Expr* parse_operand(const vector<Token>& tokens, int& idx, const string& after);
+		vector<ASTNode*> parse_block(const vector<Token>& tokens, int& idx);
+		vector<Token> lazy_tokens; // kept after a lazy parse for the bodies it skipped
+		bool failed = false; // the statement being parsed reported an error, so the parse resumes at its end
+		int loops = 0; // the loops the statement being parsed is nested in, within its function
+		vector<ASTNode*> parse_loop_block(const vector<Token>& tokens, int& idx);
+		int skip_body(const vector<Token>& tokens, int& idx, bool& starts_tasks);
+		void report_error(const string& msg, const vector<Token>& tokens, int at, bool warning = false);
+		void synchronize(const vector<Token>& tokens, int& idx, int start);
+		void parse_variable_declaration(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST);
+		void parse_assignment_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST);
+		void parse_fc_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST);
+		void parse_print_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST);
+		void parse_fd_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST);
+		void parse_input_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST);
+		void parse_for_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST);
+		void parse_foreach_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST);
+		void parse_while_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST);
+		void parse_do_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST);
+		void parse_if_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST);
+		void parse_return_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST);
+		void parse_loop_jump_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST);
+		void parse_switch_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST);
+		void parse_task_statement(const vector<Token>& tokens, int& idx, vector<ASTNode*>& AST);
+		FunctionCall* parse_call_arguments(const string& name, const vector<Token>& tokens, int& idx);
+};
\ No newline at end of file
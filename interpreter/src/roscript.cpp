@@ -1,31 +1,171 @@
 #include <iostream>
 #include "lexer.h"
 #include "interpreter.h"
+#include "server.h"
+#include "batch.h"
+#include "bench.h"
+#include "memory.h"
+#include "trace.h"
+#include "lsp.h"
 using namespace std;
 
-void process(string filename, bool profiler){
-	pair<vector<pair<string, string>>,vector<int>> tokens = lexer(filename);
+int process(string filename, bool profiler, bool memory, bool lazy, const Limits& limits, const string& trace_path){
+	if (memory) memory_tracking_start();
+	Interpreter interpreter;
+	interpreter.limits = limits;
+	interpreter.lazy_functions = lazy;
+	if (!interpreter.load_file(filename)) {
+		if (memory) memory_report(cout); // what lexing and parsing allocated before the error
+		return 1;
+	}
+	unique_ptr<Tracer> tracer;
+	if (!trace_path.empty()) {
+		tracer.reset(new Tracer());
+		interpreter.ctx.tracer = tracer.get();
+	}
 
-	/*for (const pair<string,string> &p : tokens.first) {
+	/*for (const pair<string,string> &p : lexer(filename).first) {
 		cout << p.first << " -> " << p.second << endl;
 	}*/
 
-	interpret(parse(tokens.first,tokens.second),false,profiler,true);
+	int status = 0;
+	try {
+		interpreter.run(false,profiler,true);
+	} catch (const exception& e) { // a runtime error or a resource limit ends the script, not the process
+		cout.flush();
+		cerr << "Runtime Error: " << e.what() << endl;
+		status = 1;
+	}
+	if (tracer && !tracer->write(trace_path, filename, interpreter.compiled)) { // written after an error too, it shows how the script got there
+		cerr << "Could not write the trace to " << trace_path << endl;
+	}
+	if (memory) memory_report(cout); // after a runtime error too, the profile shows what the run allocated up to it
+	return status;
+}
+
+long long integer_argument(const string& text){
+	// the whole argument has to be a number: stoll alone takes "12abc" as 12; throws invalid_argument or out_of_range
+	size_t end = 0;
+	long long value = stoll(text, &end);
+	if (end != text.size()) throw invalid_argument(text);
+	return value;
 }
 
-int main(int argc, char *argv[]){
-	switch (argc) {
-		case 1: cout<<"No file specified in the command.\n"; break;
-		case 2: process(argv[1], false); break;
-		case 3: {
-			if (string(argv[1]) == "-p") {
-				process(argv[2], true);
-			} else {
+double real_argument(const string& text){
+	size_t end = 0;
+	double value = stod(text, &end);
+	if (end != text.size()) throw invalid_argument(text);
+	return value;
+}
+
+int invalid_number(char *argv[], int i){
+	cout<<"Invalid number in the command line arguments: "<<argv[i]<<"\n";
+	return 1;
+}
+
+bool parse_limit(int argc, char *argv[], int& i, Limits& limits){
+	// --max-ops <operations> | --max-mem <MB> | --timeout <ms>, returns false if argv[i] is not a limit
+	string arg = argv[i];
+	if (i + 1 >= argc) return false;
+	if (arg == "--max-ops") limits.max_operations = max(0ll, integer_argument(argv[++i]));
+	else if (arg == "--max-mem") limits.max_memory = max(0ll, integer_argument(argv[++i])) * 1024 * 1024;
+	else if (arg == "--timeout") limits.timeout_ms = integer_argument(argv[++i]);
+	else return false;
+	return true;
+}
+
+int batch(int argc, char *argv[]){
+	// ros --batch <dir|list|file.ros> [-j threads] [-t timeout_ms] [--max-ops N] [--max-mem MB]
+	// ros --diagnostics <dir|list|file.ros> [-j threads]
+	// ros --check <dir|list|file.ros> [-j threads] [--json]
+	BatchOptions options;
+	bool json = false;
+	for (int i = 3; i < argc; i++) {
+		string arg = argv[i];
+		try {
+			if (arg == "-j" && i + 1 < argc) options.threads = max(1ll, integer_argument(argv[++i]));
+			else if (arg == "-t" && i + 1 < argc) options.limits.timeout_ms = integer_argument(argv[++i]);
+			else if (arg == "--json") json = true;
+			else if (parse_limit(argc, argv, i, options.limits)) continue;
+			else {
 				cout<<"Invalid command line arguments.\n";
+				return 1;
 			}
-			break;
+		} catch (const logic_error&) { // invalid_argument or out_of_range from the conversion
+			return invalid_number(argv, i);
 		}
-		default: cout<<"Too many arguments specified.\n"; break;
 	}
-	return 0;
+	if (string(argv[1]) == "--diagnostics") return run_diagnostics(argv[2], options);
+	if (string(argv[1]) == "--check") return run_diagnostics(argv[2], options, true, json);
+	return run_batch(argv[2], options);
+}
+
+int bench(int argc, char *argv[]){
+	// ros --bench [dir] [-w warmup] [-r repeats] [-o results.json] [-b baseline.json] [-x threshold_percent]
+	BenchOptions options;
+	for (int i = 2; i < argc; i++) {
+		string arg = argv[i];
+		try {
+			if (arg == "-w" && i + 1 < argc) options.warmup = max(0ll, integer_argument(argv[++i]));
+			else if (arg == "-r" && i + 1 < argc) options.repeats = integer_argument(argv[++i]);
+			else if (arg == "-o" && i + 1 < argc) options.json = argv[++i];
+			else if (arg == "-b" && i + 1 < argc) options.baseline = argv[++i];
+			else if (arg == "-x" && i + 1 < argc) options.threshold = real_argument(argv[++i]);
+			else if (i == 2 && arg[0] != '-') options.dir = arg;
+			else {
+				cout<<"Invalid command line arguments.\n";
+				return 1;
+			}
+		} catch (const logic_error&) {
+			return invalid_number(argv, i);
+		}
+	}
+	return run_bench(options);
+}
+
+int main(int argc, char *argv[]){
+	if (argc >= 3 && (string(argv[1]) == "--batch" || string(argv[1]) == "--diagnostics" || string(argv[1]) == "--check")) return batch(argc, argv);
+	if (argc >= 2 && string(argv[1]) == "--bench") return bench(argc, argv);
+	if (argc == 3 && string(argv[1]) == "--trace-dump") return dump_trace(argv[2], cout);
+	if (argc == 2 && string(argv[1]) == "--lsp") return run_lsp(cin, cout);
+
+	if (argc == 1) {
+		cout<<"No file specified in the command.\n";
+		return 0;
+	}
+
+	// ros [-p | -m] [--lazy] [--trace out.trace] [--max-ops N] [--max-mem MB] [--timeout ms] <file.ros>
+	// ros --trace-dump <file.trace>
+	// ros --lsp
+	// ros --serve [socket_path] [--max-ops N] [--max-mem MB] [--timeout ms]
+	bool serve_mode = string(argv[1]) == "--serve", profiler = false, memory = false, lazy = false;
+	string target, trace_path;
+	Limits limits;
+	for (int i = serve_mode ? 2 : 1; i < argc; i++) {
+		string arg = argv[i];
+		try {
+			if (parse_limit(argc, argv, i, limits)) continue;
+		} catch (const logic_error&) {
+			return invalid_number(argv, i);
+		}
+		if (!serve_mode && arg == "-p") profiler = true;
+		else if (!serve_mode && arg == "-m") memory = true;
+		else if (!serve_mode && arg == "--lazy") lazy = true;
+		else if (!serve_mode && arg == "--trace" && i + 1 < argc) trace_path = argv[++i];
+		else if (target.empty() && arg[0] != '-') target = arg;
+		else {
+			cout<<"Invalid command line arguments.\n";
+			return 1;
+		}
+	}
+
+	if (serve_mode) {
+		serve(target.empty() ? default_socket_path : target, limits);
+		return 0;
+	}
+	if (target.empty()) {
+		cout<<"No file specified in the command.\n";
+		return 0;
+	}
+	return process(target, profiler, memory, lazy, limits, trace_path);
 }
@@ -0,0 +1,230 @@
+/**
+ * @file server.cpp
+ * @brief Server mode implementation for the Roscript interpreter.
+ * This file contains the socket loop behind `ros --serve` and the stream buffers that connect a script's streams to the client.
+ * @see server.h
+ *
+ * @author Rares-Cosma & Vlad-Oprea
+ * @date 2026-10-18
+ */
+#include "server.h"
+#include "interpreter.h"
+#include <algorithm>
+#include <sstream>
+#include <streambuf>
+#include <thread>
+#include <stdexcept>
+#include <csignal>
+#include <cstring>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+static bool write_all(int fd, const char* data, size_t size) {
+    /**
+     * @brief Writes the whole buffer to the file descriptor, retrying on partial writes.
+     * @return false if the client went away.
+     */
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+/**
+ * @class FrameBuf
+ * @brief Output stream buffer that sends everything written to it as frames of one channel.
+ * @note A frame is sent when the buffer fills up or when the stream is flushed (endl, cerr), so output is streamed while the script runs.
+ */
+class FrameBuf : public streambuf {
+    public:
+        FrameBuf(int fd, char channel) : fd(fd), channel(channel) {}
+
+        void send_frame() {
+            if (buffer.empty()) return;
+            string header = string(1, channel) + " " + to_string(buffer.size()) + "\n";
+            write_all(fd, header.data(), header.size());
+            write_all(fd, buffer.data(), buffer.size());
+            buffer.clear();
+        }
+
+    protected:
+        int overflow(int c) override {
+            if (c != EOF) {
+                buffer += static_cast<char>(c);
+                if (buffer.size() >= frame_size) send_frame();
+            }
+            return c;
+        }
+
+        streamsize xsputn(const char* s, streamsize n) override {
+            buffer.append(s, n);
+            if (buffer.size() >= frame_size) send_frame();
+            return n;
+        }
+
+        int sync() override {
+            send_frame();
+            return 0;
+        }
+
+    private:
+        static const size_t frame_size = 4096;
+        int fd;
+        char channel;
+        string buffer;
+};
+
+/**
+ * @class FdInBuf
+ * @brief Input stream buffer reading from the client socket.
+ * @note The same buffer is used for the request header and for the script's standard input, so bytes read ahead are not lost.
+ */
+class FdInBuf : public streambuf {
+    public:
+        FdInBuf(int fd) : fd(fd) {}
+
+    protected:
+        int underflow() override {
+            if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+            ssize_t got;
+            do {
+                got = read(fd, buffer, sizeof(buffer));
+            } while (got < 0 && errno == EINTR);
+            if (got <= 0) return EOF;
+            setg(buffer, buffer, buffer + got);
+            return traits_type::to_int_type(*gptr());
+        }
+
+    private:
+        int fd;
+        char buffer[4096];
+};
+
+static const size_t max_source_size = 64 * 1024 * 1024; // largest SRC body a client may send
+
+static int run_request(istream& request, Interpreter& interpreter) {
+    /**
+     * @brief Reads one request, then lexes, parses and interprets the script in the given interpreter.
+     * @param request The client stream, positioned at the request header.
+     * @return The status sent back in the final frame.
+     */
+    string command;
+    if (!getline(request, command)) {
+        *interpreter.ctx.err << "Empty request" << endl;
+        return 1;
+    }
+
+    if (command.rfind("RUN ", 0) == 0) {
+        if (!interpreter.load_file(command.substr(4))) return 1;
+    } else if (command.rfind("SRC ", 0) == 0) {
+        size_t size = stoul(command.substr(4));
+        size_t max_size = interpreter.limits.max_memory > 0 ? min(max_source_size, static_cast<size_t>(interpreter.limits.max_memory)) : max_source_size;
+        if (size > max_size) { // checked before allocating, the size comes straight from the client
+            *interpreter.ctx.err << "Source too large: " << size << " bytes (at most " << max_size << ")" << endl;
+            return 1;
+        }
+        string source(size, '\0');
+        request.read(&source[0], size);
+        if (static_cast<size_t>(request.gcount()) != size) {
+            *interpreter.ctx.err << "Truncated source: expected " << size << " bytes, got " << request.gcount() << endl;
+            return 1;
+        }
+        if (!interpreter.load_source(source)) return 1;
+    } else {
+        *interpreter.ctx.err << "Unknown request: " << command << endl;
+        return 1;
+    }
+
+    interpreter.run(false, false, false);
+    return 0;
+}
+
+static void handle_client(int client, const Limits& limits) {
+    /**
+     * @brief Runs one request in a fresh interpreter whose streams are connected to the client.
+     */
+    FdInBuf in(client);
+    FrameBuf out(client, 'O'), err(client, 'E');
+    istream request(&in);
+    ostream out_stream(&out), err_stream(&err);
+    err_stream.setf(ios::unitbuf); // like cerr, errors are sent as soon as they are written
+    err_stream.tie(&out_stream); // and pending output goes first, so the frames keep their order
+
+    int status = 1;
+    {
+        Interpreter interpreter(out_stream, request, err_stream);
+        interpreter.limits = limits;
+        try {
+            status = run_request(request, interpreter);
+        } catch (const exception& e) {
+            err_stream << "Runtime Error: " << e.what() << endl;
+        }
+    }
+    out_stream.flush();
+    err_stream.flush();
+
+    string done = "X " + to_string(status) + "\n";
+    write_all(client, done.data(), done.size());
+}
+
+void serve(const string& socket_path, const Limits& limits) {
+    signal(SIGPIPE, SIG_IGN); // a client closing early must not kill the server
+
+    int server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server_fd < 0) {
+        cerr << "Could not create socket: " << strerror(errno) << endl;
+        return;
+    }
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(addr.sun_path)) {
+        cerr << "Socket path too long: " << socket_path << endl;
+        close(server_fd);
+        return;
+    }
+    strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+    struct stat existing;
+    if (lstat(socket_path.c_str(), &existing) == 0) {
+        if (!S_ISSOCK(existing.st_mode)) { // never delete a file that is not a socket, e.g. `ros --serve script.ros`
+            cerr << "Not a socket, refusing to replace: " << socket_path << endl;
+            close(server_fd);
+            return;
+        }
+        unlink(socket_path.c_str()); // remove a stale socket left by a previous server
+    }
+
+    if (bind(server_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(server_fd, 64) < 0) {
+        cerr << "Could not listen on " << socket_path << ": " << strerror(errno) << endl;
+        close(server_fd);
+        return;
+    }
+    cout << "Listening on " << socket_path << endl;
+
+    while (true) {
+        int client = accept(server_fd, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR) continue;
+            cerr << "Accept failed: " << strerror(errno) << endl;
+            break;
+        }
+        thread([client, limits]() { // every connection gets its own thread and interpreter
+            handle_client(client, limits);
+            close(client);
+        }).detach();
+    }
+
+    close(server_fd);
+    unlink(socket_path.c_str());
+}
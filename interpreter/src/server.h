@@ -0,0 +1,27 @@
+/**
+ * @file server.h
+ * @brief Header file for the server mode of the Roscript interpreter.
+ * The server keeps one warm process listening on a Unix domain socket and runs every received script in its own Interpreter.
+ * @author Rares-Cosma & Vlad-Oprea
+ * @date 2026-10-18
+ */
+
+#pragma once
+#include <string>
+#include "variables.h"
+
+using namespace std;
+
+inline const string default_socket_path = "/tmp/ros.sock"; // used when `ros --serve` gets no path
+
+/**
+ * @brief Listens on a Unix domain socket and runs one script per connection, each connection in its own thread.
+ * @param socket_path The path of the socket file, replaced if it already exists.
+ * @param limits Resource limits applied to every script, so one runaway client cannot take the server down.
+ * @note Protocol, one request per connection:
+ * - the client sends `RUN <path>\n` to run a script file, or `SRC <n>\n` followed by n bytes of source code;
+ * - every byte sent after the request is the script's standard input;
+ * - the server streams back frames `O <n>\n<bytes>` (stdout) and `E <n>\n<bytes>` (stderr),
+ *   then a final `X <status>\n` (0 on success, 1 on error) and closes the connection.
+ */
+void serve(const string& socket_path, const Limits& limits = Limits());
@@ -10,14 +10,32 @@
 #include "variables.h"
 #include <functional>
 #include <cmath>
+#include <algorithm>
+#include <stdexcept>
 #include <iostream>
 
-using BuiltinFunc = function<Value(const vector<Value>&)>;
+using BuiltinFunc = function<Value(Context&, const vector<Value>&)>; // builtins get the context of the calling script
+
+inline void print_value(ostream& out, const Value& value) {
+    /**
+     * @brief Writes a value the way afiseaza shows it.
+     * @note Also used by the executor, which prints the arguments of a plain `afiseaza(...)` statement without calling the builtin.
+     */
+    if (holds_alternative<int>(value)) {
+        out << get<int>(value);
+    } else if (holds_alternative<float>(value)) {
+        out << get<float>(value);
+    } else if (holds_alternative<string>(value)) {
+        out << get<string>(value);
+    } else {
+        out << (get<bool>(value) ? "true" : "false");
+    }
+}
 
 inline unordered_map<string, BuiltinFunc> stdlib = {
-    {"int", [](const vector<Value>& args) {
+    {"int", [](Context&, const vector<Value>& args) {
         if (args.size() != 1) {
-            throw "int function expects a single argument";
+            throw runtime_error("int function expects a single argument");
         }
         if (holds_alternative<int>(args[0])) {
             return args[0]; // already a Value holding int
@@ -28,12 +46,12 @@ inline unordered_map<string, BuiltinFunc> stdlib = {
         } else if (holds_alternative<bool>(args[0])) {
             return Value{get<bool>(args[0]) ? 1 : 0};
         } else {
-            throw "int function cannot convert the provided type";
+            throw runtime_error("int function cannot convert the provided type");
         }
     }},
-    {"float", [](const vector<Value>& args) {
+    {"float", [](Context&, const vector<Value>& args) {
         if (args.size() != 1) {
-            throw "float function expects a single argument";
+            throw runtime_error("float function expects a single argument");
         }
         if (holds_alternative<float>(args[0])) {
             return args[0]; // already a Value holding float
@@ -44,12 +62,12 @@ inline unordered_map<string, BuiltinFunc> stdlib = {
         } else if (holds_alternative<bool>(args[0])) {
             return Value{get<bool>(args[0]) ? 1.0f : 0.0f};
         } else {
-            throw "float function cannot convert the provided type";
+            throw runtime_error("float function cannot convert the provided type");
         }
     }},
-    {"bool", [](const vector<Value>& args) {
+    {"bool", [](Context&, const vector<Value>& args) {
         if (args.size() != 1)
-            throw "bool function expects a single argument";
+            throw runtime_error("bool function expects a single argument");
 
         if (holds_alternative<bool>(args[0]))
             return args[0];
@@ -60,11 +78,11 @@ inline unordered_map<string, BuiltinFunc> stdlib = {
         if (holds_alternative<string>(args[0]))
             return Value{!get<string>(args[0]).empty()};
 
-        throw "bool function cannot convert the provided type";
+        throw runtime_error("bool function cannot convert the provided type");
     }},
-    {"string", [](const vector<Value>& args) {
+    {"string", [](Context&, const vector<Value>& args) {
         if (args.size() != 1)
-            throw "string function expects a single argument";
+            throw runtime_error("string function expects a single argument");
 
         if (holds_alternative<string>(args[0]))
             return args[0];
@@ -75,21 +93,21 @@ inline unordered_map<string, BuiltinFunc> stdlib = {
         if (holds_alternative<bool>(args[0]))
             return Value{get<bool>(args[0]) ? "true" : "false"};
 
-        throw "string function cannot convert the provided type";
+        throw runtime_error("string function cannot convert the provided type");
     }},
-    {"lungime", [](const vector<Value>& args) {
+    {"lungime", [](Context&, const vector<Value>& args) {
         if (args.size() != 1)
-            throw "len function expects a single argument";
+            throw runtime_error("len function expects a single argument");
 
         if (holds_alternative<string>(args[0]))
             return Value{static_cast<int>(get<string>(args[0]).length())};
-        else throw "len function expects a string argument";
+        else throw runtime_error("len function expects a string argument");
 
-        throw "len function cannot convert the provided type";
+        throw runtime_error("len function cannot convert the provided type");
     }},
-    {"tip", [](const vector<Value>& args) {
+    {"tip", [](Context&, const vector<Value>& args) {
         if (args.size() != 1)
-            throw "type function expects a single argument";
+            throw runtime_error("type function expects a single argument");
 
         if (holds_alternative<int>(args[0]))
             return Value{"int"};
@@ -100,49 +118,120 @@ inline unordered_map<string, BuiltinFunc> stdlib = {
         if (holds_alternative<bool>(args[0]))
             return Value{"bool"};
 
-        throw "type function cannot determine the type of the provided value";
+        throw runtime_error("type function cannot determine the type of the provided value");
     }},
-    {"citeste", [](const vector<Value>& args) {
+    {"citeste", [](Context& ctx, const vector<Value>& args) {
         if (args.size() > 1) {
-            throw "citeste function expects a single string argument";
+            throw runtime_error("citeste function expects a single string argument");
         }
         if (args.size()==0){
             string input;
-            getline(cin, input);
+            getline(*ctx.in, input);
             return Value{input}; // return the input as a string
         }
         string prompt = get<string>(args[0]);
-        cout << prompt;
+        *ctx.out << prompt;
         string input;
-        getline(cin, input);
+        getline(*ctx.in, input);
         return Value{input}; // return the input as a string
     }},
-    {"sqrt", [](const vector<Value>& args) {
+    {"sqrt", [](Context&, const vector<Value>& args) {
         if (args.size() != 1) {
-            throw "sqrt function expects a single argument";
+            throw runtime_error("sqrt function expects a single argument");
         }
         if (holds_alternative<int>(args[0])) {
             return Value{sqrt(static_cast<float>(get<int>(args[0])))};
         } else if (holds_alternative<float>(args[0])) {
             return Value{sqrt(get<float>(args[0]))};
         } else {
-            throw "sqrt function expects an int or float argument";
+            throw runtime_error("sqrt function expects an int or float argument");
         }
     }},
-    {"afiseaza", [](const vector<Value>& args) {
+    {"afiseaza", [](Context& ctx, const vector<Value>& args) {
         for (auto& arg : args) {
-            if (holds_alternative<int>(arg)) {
-                cout << get<int>(arg);
-            } else if (holds_alternative<float>(arg)) {
-                cout << get<float>(arg);
-            } else if (holds_alternative<string>(arg)) {
-                cout << get<string>(arg);
-            } else if (holds_alternative<bool>(arg)) {
-                cout << (get<bool>(arg) ? "true" : "false");
-            } else {
-                throw "afiseaza function cannot handle the provided type";
-            }
+            print_value(*ctx.out, arg);
         }
         return Value{0}; // indicate success
+    }},
+    {"subsir", [](Context&, const vector<Value>& args) {
+        // subsir(s, start[, length]): the characters of s from start on, all of them if no length is given
+        if (args.size() != 2 && args.size() != 3)
+            throw runtime_error("subsir function expects a string, a start and an optional length");
+        if (!holds_alternative<string>(args[0]) || !holds_alternative<int>(args[1]) || (args.size() == 3 && !holds_alternative<int>(args[2])))
+            throw runtime_error("subsir function expects a string and int positions");
+
+        const string& s = get<string>(args[0]);
+        int start = get<int>(args[1]);
+        if (start < 0 || start > static_cast<int>(s.size()))
+            throw runtime_error("subsir start is outside of the string");
+        size_t length = args.size() == 3 ? static_cast<size_t>(max(0, get<int>(args[2]))) : string::npos;
+        return Value{string(s, start, length)}; // built straight from the source, without an intermediate copy
+    }},
+    {"uneste", [](Context&, const vector<Value>& args) {
+        // uneste(separator, parts...): the parts joined by the separator
+        if (args.empty())
+            throw runtime_error("uneste function expects a separator");
+        size_t size = 0;
+        for (const Value& arg : args) {
+            if (!holds_alternative<string>(arg))
+                throw runtime_error("uneste function expects string arguments");
+            size += get<string>(arg).size();
+        }
+        const string& separator = get<string>(args[0]);
+        string result;
+        result.reserve(size - separator.size() + separator.size() * (args.size() > 2 ? args.size() - 2 : 0)); // one allocation
+        for (size_t i = 1; i < args.size(); i++) {
+            if (i > 1) result += separator;
+            result += get<string>(args[i]);
+        }
+        return Value{move(result)};
+    }},
+    {"parte", [](Context&, const vector<Value>& args) {
+        // parte(s, separator, index): field number index (from 0) of s split at the separator, "" past the last one
+        if (args.size() != 3)
+            throw runtime_error("parte function expects a string, a separator and an index");
+        if (!holds_alternative<string>(args[0]) || !holds_alternative<string>(args[1]) || !holds_alternative<int>(args[2]))
+            throw runtime_error("parte function expects two strings and an int");
+
+        const string& s = get<string>(args[0]);
+        const string& separator = get<string>(args[1]);
+        if (separator.empty())
+            throw runtime_error("parte separator cannot be empty");
+        int index = get<int>(args[2]);
+        if (index < 0) return Value{string()};
+        size_t begin = 0; // only the wanted field is copied, the ones before it are skipped over
+        for (; index > 0; index--) {
+            begin = s.find(separator, begin);
+            if (begin == string::npos) return Value{string()};
+            begin += separator.size();
+        }
+        size_t end = s.find(separator, begin);
+        return Value{string(s, begin, end == string::npos ? string::npos : end - begin)};
     }}
-};
\ No newline at end of file
+};
+
+/**
+ * @struct BuiltinSignature
+ * @brief What is known of a builtin without calling it, for the static checker and the editor hovers.
+ */
+struct BuiltinSignature {
+    int min_args, max_args; // max_args is -1 for any number of arguments
+    string argument; // the types the arguments may have, separated by spaces, empty for any
+    string result; // the type returned, empty if it depends on the argument
+    bool pure = true; // the result depends on the arguments alone and the call has no effect, so equal calls may share it
+};
+
+inline const unordered_map<string, BuiltinSignature> stdlib_signatures = {
+    {"int", {1, 1, "", "int"}},
+    {"float", {1, 1, "", "float"}},
+    {"bool", {1, 1, "", "bool"}},
+    {"string", {1, 1, "", "string"}},
+    {"lungime", {1, 1, "string", "int"}},
+    {"tip", {1, 1, "", "string"}},
+    {"citeste", {0, 1, "string", "string", false}},
+    {"sqrt", {1, 1, "int float", "float"}},
+    {"afiseaza", {0, -1, "", "int", false}},
+    {"subsir", {2, 3, "", "string"}},
+    {"uneste", {1, -1, "string", "string"}},
+    {"parte", {3, 3, "", "string"}},
+};
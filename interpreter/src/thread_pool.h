@@ -0,0 +1,84 @@
+/**
+ * @file thread_pool.h
+ * @brief Work-stealing parallel loop used by the batch runner.
+ * Jobs are dealt round-robin into one deque per worker; a worker pops from the back of its own deque and, once it runs dry, steals from the front of the others.
+ * @author Rares-Cosma & Vlad-Oprea
+ * @date 2026-10-18
+ */
+
+#pragma once
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @class WorkStealingPool
+ * @brief Runs a fixed set of indexed jobs on a number of worker threads.
+ */
+class WorkStealingPool {
+	public:
+		WorkStealingPool(unsigned threads) : workers(threads ? threads : 1) {}
+
+		void run(size_t job_count, const function<void(size_t)>& job) {
+			/**
+			 * @brief Calls job(i) for every i in [0, job_count) and returns when all of them finished.
+			 * @note The calling thread works as well, so a pool of one thread runs everything inline.
+			 */
+			size_t threads = min<size_t>(workers, job_count ? job_count : 1);
+			vector<Queue> queues(threads);
+			for (size_t i = 0; i < job_count; i++) {
+				queues[i % threads].jobs.push_back(i);
+			}
+
+			vector<thread> pool;
+			for (size_t w = 1; w < threads; w++) {
+				pool.emplace_back([&, w]() { work(queues, w, job); });
+			}
+			work(queues, 0, job);
+			for (auto& t : pool) t.join();
+		}
+
+	private:
+		struct Queue {
+			mutex lock;
+			deque<size_t> jobs;
+		};
+
+		unsigned workers;
+
+		static bool pop_own(Queue& q, size_t& job) {
+			lock_guard<mutex> guard(q.lock);
+			if (q.jobs.empty()) return false;
+			job = q.jobs.back();
+			q.jobs.pop_back();
+			return true;
+		}
+
+		static bool steal(Queue& q, size_t& job) {
+			lock_guard<mutex> guard(q.lock);
+			if (q.jobs.empty()) return false;
+			job = q.jobs.front();
+			q.jobs.pop_front();
+			return true;
+		}
+
+		static void work(vector<Queue>& queues, size_t self, const function<void(size_t)>& job) {
+			size_t current;
+			while (true) {
+				if (pop_own(queues[self], current)) {
+					job(current);
+					continue;
+				}
+				bool stolen = false;
+				for (size_t i = 1; i < queues.size() && !stolen; i++) {
+					stolen = steal(queues[(self + i) % queues.size()], current);
+				}
+				if (!stolen) return; // no job is ever added while running, so every queue is empty
+				job(current);
+			}
+		}
+};
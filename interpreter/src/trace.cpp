@@ -0,0 +1,223 @@
+/**
+ * @file trace.cpp
+ * @brief Execution tracer implementation for the Roscript interpreter.
+ * This file contains the trace file format: a header naming the traced script, the table of sites (the line, kind and name of
+ * every instruction, function or chunk the events refer to), then the events oldest first. Integers are stored in host byte order.
+ * @see trace.h
+ *
+ * @author Rares-Cosma & Vlad-Oprea
+ * @date 2026-10-18
+ */
+#include "trace.h"
+#include "interpreter.h"
+#include <fstream>
+#include <iomanip>
+#include <map>
+
+static const char trace_magic[8] = {'R', 'O', 'S', 'T', 'R', 'A', 'C', 'E'};
+static const uint32_t trace_version = 1;
+
+/**
+ * @struct TraceSite
+ * @brief What the dump needs to know about the site of an event.
+ */
+struct TraceSite {
+	int32_t line = 0;
+	string label; // node type of an instruction, "function" for a call or a return
+	string name; // the variable written, or the function called or returning
+};
+
+Tracer::Tracer(size_t capacity) {
+	size_t size = 1;
+	while (size < capacity) size <<= 1; // a power of two, so the ring index is a mask
+	events.reset(new TraceEvent[size]);
+	mask = size - 1;
+}
+
+template <typename T>
+static void put(ostream& out, T value) {
+	out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static void put_string(ostream& out, const string& s) {
+	put<uint32_t>(out, s.size());
+	out.write(s.data(), s.size());
+}
+
+template <typename T>
+static bool take(istream& in, T& value) {
+	return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+static bool take_string(istream& in, string& s) {
+	uint32_t size;
+	if (!take(in, size) || size > (1u << 24)) return false;
+	s.resize(size);
+	return static_cast<bool>(in.read(&s[0], size));
+}
+
+static string source_name(const string& name) {
+	/**
+	 * @brief The name a variable has in the source: a block variable's hidden slot "#x@3" (see BlockScoper) is shown as x.
+	 */
+	size_t at = name.rfind('@');
+	return !name.empty() && name[0] == '#' && at != string::npos ? name.substr(1, at - 1) : name;
+}
+
+bool Tracer::write(const string& path, const string& script, const Program& program) const {
+	/**
+	 * @brief Resolves the sites of the kept events and writes the trace file.
+	 */
+	uint64_t first = head > mask + 1 ? head - (mask + 1) : 0;
+
+	unordered_map<const Chunk*, const FunctionDefinition*> chunk_functions;
+	for (const auto& [func, chunk] : program.functions) chunk_functions[&chunk] = func;
+
+	map<pair<uint8_t, const void*>, uint32_t> site_ids; // CALL and RETURN sites are not instructions, so the kind is part of the key
+	vector<TraceSite> sites;
+	vector<uint32_t> event_sites;
+	for (uint64_t i = first; i < head; i++) {
+		const TraceEvent& event = events[i & mask];
+		uint8_t group = event.kind == TRACE_CALL || event.kind == TRACE_RETURN ? event.kind : static_cast<uint8_t>(TRACE_STATEMENT);
+		auto [it, added] = site_ids.try_emplace({group, event.site}, sites.size());
+		if (added) {
+			TraceSite site;
+			if (event.kind == TRACE_CALL || event.kind == TRACE_RETURN) {
+				auto* func = event.kind == TRACE_CALL ? static_cast<const FunctionDefinition*>(event.site)
+				                                      : chunk_functions.at(static_cast<const Chunk*>(event.site));
+				site.line = func->line;
+				site.label = "function";
+				site.name = func->name;
+			} else {
+				auto* ins = static_cast<const Instruction*>(event.site);
+				site.line = ins->line;
+				site.label = ins->node_type;
+				site.name = source_name(ins->name);
+			}
+			sites.push_back(move(site));
+		}
+		event_sites.push_back(it->second);
+	}
+
+	ofstream out(path, ios::binary);
+	if (!out) return false;
+	out.write(trace_magic, sizeof(trace_magic));
+	put(out, trace_version);
+	put<uint64_t>(out, head);
+	put<uint64_t>(out, head - first);
+	put_string(out, script);
+	put<uint32_t>(out, sites.size());
+	for (const TraceSite& site : sites) {
+		put(out, site.line);
+		put_string(out, site.label);
+		put_string(out, site.name);
+	}
+	for (uint64_t i = first; i < head; i++) {
+		const TraceEvent& event = events[i & mask];
+		put(out, event_sites[i - first]);
+		put(out, event.task);
+		put(out, event.kind);
+		put(out, event.type);
+		put(out, event.length);
+		put(out, event.value);
+	}
+	return static_cast<bool>(out);
+}
+
+static string format_value(uint8_t type, uint64_t bits, uint32_t length) {
+	switch (type) {
+		case TRACE_INT:
+			return to_string(static_cast<int>(static_cast<int64_t>(bits)));
+		case TRACE_FLOAT: {
+			uint32_t raw = static_cast<uint32_t>(bits);
+			float f;
+			memcpy(&f, &raw, sizeof(f));
+			return variant_to_string(f);
+		}
+		case TRACE_STRING: {
+			char prefix[sizeof(bits)];
+			memcpy(prefix, &bits, sizeof(bits));
+			string s(prefix, min<size_t>(length, sizeof(bits)));
+			return "\"" + s + (length > sizeof(bits) ? "...\" (" + to_string(length) + " chars)" : "\"");
+		}
+		case TRACE_BOOL:
+			return variant_to_string(bits != 0);
+	}
+	return "";
+}
+
+int dump_trace(const string& path, ostream& out) {
+	/**
+	 * @brief Decodes the trace file; source lines are shown for statements and decisions when the script is still readable.
+	 */
+	ifstream in(path, ios::binary);
+	char magic[sizeof(trace_magic)];
+	uint32_t version = 0;
+	if (!in || !in.read(magic, sizeof(magic)) || memcmp(magic, trace_magic, sizeof(magic)) != 0 || !take(in, version) || version != trace_version) {
+		cerr << "Not a Roscript trace file: " << path << endl;
+		return 1;
+	}
+
+	uint64_t recorded = 0, kept = 0;
+	string script;
+	uint32_t site_count = 0;
+	bool ok = take(in, recorded) && take(in, kept) && take_string(in, script) && take(in, site_count);
+	vector<TraceSite> sites(ok ? site_count : 0);
+	for (TraceSite& site : sites) {
+		ok = ok && take(in, site.line) && take_string(in, site.label) && take_string(in, site.name);
+	}
+	if (!ok) {
+		cerr << "Truncated trace file: " << path << endl;
+		return 1;
+	}
+
+	vector<string> source;
+	ifstream source_file(script);
+	for (string line; getline(source_file, line);) source.push_back(line);
+
+	out << "Trace of " << script << ": " << recorded << " events recorded, the last " << kept << " kept.\n";
+	for (uint64_t i = 0; i < kept; i++) {
+		uint32_t site_id, length;
+		uint16_t task;
+		uint8_t kind, type;
+		uint64_t value;
+		if (!take(in, site_id) || !take(in, task) || !take(in, kind) || !take(in, type) || !take(in, length) || !take(in, value) || site_id >= sites.size()) {
+			cerr << "Truncated trace file: " << path << endl;
+			return 1;
+		}
+		const TraceSite& site = sites[site_id];
+
+		string description;
+		bool show_source = false;
+		switch (kind) {
+			case TRACE_STATEMENT:
+				description = site.label;
+				show_source = true;
+				break;
+			case TRACE_WRITE:
+				description = site.name + " = " + format_value(type, value, length);
+				break;
+			case TRACE_DECISION:
+				if (site.label == "IfStatement") description = value ? "branch taken" : "branch skipped";
+				else description = string(value ? "loop continues" : "loop exits") + " (" + site.label + ")";
+				show_source = true;
+				break;
+			case TRACE_CALL:
+				description = "call " + site.name;
+				break;
+			case TRACE_RETURN:
+				description = "return from " + site.name + ": " + format_value(type, value, length);
+				break;
+			default:
+				description = "unknown event";
+		}
+
+		out << setw(8) << recorded - kept + i << "  task " << setw(3) << left << task << right << "  line " << setw(5) << left
+		    << site.line << right << "  " << description;
+		if (show_source && site.line > 0 && site.line <= static_cast<int>(source.size())) {
+			out << "    | " << source[site.line - 1];
+		}
+		out << "\n";
+	}
+	return 0;
+}
@@ -0,0 +1,122 @@
+/**
+ * @file trace.h
+ * @brief Header file for the execution tracer of the Roscript interpreter.
+ * While `ros --trace` runs, the executor records executed statements, variable writes, branch and loop decisions and function
+ * calls into a fixed-size ring buffer, which is written to a binary file when the script ends (also on a runtime error).
+ * `ros --trace-dump` decodes the file back into a readable log with the source lines.
+ * @author Rares-Cosma & Vlad-Oprea
+ * @date 2026-10-18
+ */
+
+#pragma once
+#include "variables.h"
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <memory>
+
+using namespace std;
+
+struct Program;
+
+/**
+ * @struct TraceEvent
+ * @brief One recorded event, 24 bytes, written with a single store into the ring.
+ * @note `site` is resolved to a line and a name only when the trace is written, so recording never formats or hashes anything.
+ */
+struct TraceEvent {
+	const void* site; // the Instruction, the FunctionDefinition of a CALL or the Chunk of a RETURN
+	uint64_t value; // int or bool value, float bits, the first 8 bytes of a string, or 1/0 for a decision
+	uint32_t length; // length of a string value
+	uint16_t task; // id of the task that ran the event
+	uint8_t kind; // a TraceKind
+	uint8_t type; // a TraceType
+};
+
+/**
+ * @enum TraceKind
+ * @brief What a trace event records.
+ */
+enum TraceKind : uint8_t {
+	TRACE_STATEMENT, // a statement started executing
+	TRACE_WRITE, // a variable got a value
+	TRACE_DECISION, // a condition was tested: the branch was entered or the loop goes on (value 1), or not (value 0)
+	TRACE_CALL, // a user function was called
+	TRACE_RETURN, // a user function returned a value
+};
+
+/**
+ * @enum TraceType
+ * @brief The type of the value carried by an event.
+ */
+enum TraceType : uint8_t { TRACE_NONE, TRACE_INT, TRACE_FLOAT, TRACE_STRING, TRACE_BOOL };
+
+/**
+ * @class Tracer
+ * @brief The ring buffer of one traced run. Once full, new events overwrite the oldest ones, so the trace keeps the last `capacity`.
+ * @note Only the thread running the executor records; the workers of a `paralel` loop run untraced.
+ */
+class Tracer {
+	public:
+		explicit Tracer(size_t capacity = 1 << 20);
+
+		void record(TraceKind kind, const void* site, int task) {
+			events[head++ & mask] = TraceEvent{site, 0, 0, static_cast<uint16_t>(task), kind, TRACE_NONE};
+		}
+
+		void record(TraceKind kind, const void* site, int task, const Value& value) {
+			TraceEvent event{site, 0, 0, static_cast<uint16_t>(task), kind, TRACE_NONE};
+			switch (value.index()) {
+				case 0:
+					event.type = TRACE_INT;
+					event.value = static_cast<uint64_t>(static_cast<int64_t>(get<int>(value)));
+					break;
+				case 1: {
+					event.type = TRACE_FLOAT;
+					float f = get<float>(value);
+					uint32_t bits;
+					memcpy(&bits, &f, sizeof(bits));
+					event.value = bits;
+					break;
+				}
+				case 2: {
+					event.type = TRACE_STRING;
+					const string& s = get<string>(value);
+					event.length = static_cast<uint32_t>(min<size_t>(s.size(), UINT32_MAX));
+					memcpy(&event.value, s.data(), min<size_t>(s.size(), sizeof(event.value)));
+					break;
+				}
+				case 3:
+					event.type = TRACE_BOOL;
+					event.value = get<bool>(value);
+					break;
+			}
+			events[head++ & mask] = event;
+		}
+
+		void decision(const void* site, int task, bool taken) {
+			events[head++ & mask] = TraceEvent{site, taken, 0, static_cast<uint16_t>(task), TRACE_DECISION, TRACE_BOOL};
+		}
+
+		/**
+		 * @brief Writes the recorded events, oldest first, with the line and name of every site they refer to.
+		 * @param path The trace file.
+		 * @param script Path of the traced script, stored so the dump can show its source lines.
+		 * @param program The compiled program the sites belong to; it must still be alive.
+		 * @return false if the file could not be written.
+		 */
+		bool write(const string& path, const string& script, const Program& program) const;
+
+	private:
+		unique_ptr<TraceEvent[]> events;
+		size_t mask;
+		uint64_t head = 0; // events recorded so far, the next one goes to head & mask
+};
+
+/**
+ * @brief Prints a trace file written by Tracer::write, one event per line with the source line it comes from.
+ * @param path The trace file.
+ * @param out Where the log is written.
+ * @return 0 on success, 1 if the file is missing or not a trace.
+ */
+int dump_trace(const string& path, ostream& out);
@@ -1,7 +1,7 @@
 /**
  * @file variables.h
  * @brief Header file for the variables management in the Roscript interpreter.
- * This file contains the declaration of the variables map and the Value type used to store different types of values.
+ * This file contains the Value type used to store different types of values and the Context holding the runtime state of a script.
  * @author Rares-Cosma & Vlad-Oprea
  * @date 2025-06-23
  */
@@ -10,7 +10,72 @@
 #include <unordered_map>
 #include <string>
 #include <variant>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <thread>
 using namespace std;
 using Value = variant<int, float, string, bool>;
 
-extern unordered_map<string, Value> variables; // Global map to store variables and their values, used by the interpreter
\ No newline at end of file
+class ASTNode;
+class Executor;
+struct MemoryBudget;
+class Tracer;
+
+/**
+ * @struct Limits
+ * @brief Resource limits of one script run, 0 meaning unlimited.
+ * @note All of them are checked at loop back-edges and function calls, so a script that hits one stops with a runtime error
+ * and leaves the process (and the other scripts running in it) intact.
+ */
+struct Limits {
+	unsigned long long max_operations = 0; // executed instructions
+	long long max_memory = 0; // live heap bytes allocated by the script
+	long timeout_ms = 0; // wall-clock time
+};
+
+/**
+ * @struct Context
+ * @brief The runtime state of one running script.
+ * @note Nothing in the runtime is process-global, so independent contexts can run in parallel threads of the same process.
+ */
+struct Context {
+	unordered_map<string, Value> variables; // map to store the global variables and their values, used by the interpreter
+	unordered_map<string, Value>* locals = nullptr; // variables of the running function call, nullptr at the top level
+	const vector<ASTNode*>* functions = nullptr; // user defined functions of the running program, owned by the parser
+	Executor* executor = nullptr; // runs user function calls and tasks, set while a program runs
+
+	ostream* out = &cout; // where afiseaza writes
+	istream* in = &cin; // where citeste reads from
+	ostream* err = &cerr; // where runtime errors are reported
+
+	unsigned threads = thread::hardware_concurrency(); // worker threads a `paralel` loop may use
+	chrono::steady_clock::time_point deadline = chrono::steady_clock::time_point::max(); // wall-clock limit, checked at loop back-edges
+	unsigned back_edges = 0; // loop iterations since the deadline was last checked
+	unsigned long long operations = 0; // instructions executed so far
+	unsigned long long max_operations = 0; // instruction budget, 0 for none
+	MemoryBudget* memory_budget = nullptr; // heap budget of the running script, nullptr for none
+	Tracer* tracer = nullptr; // records the execution for `ros --trace`, nullptr when not tracing
+
+	unordered_map<string, chrono::microseconds> node_times; // profiler data, time spent per node type
+	unordered_map<string, int> node_counts; // profiler data, executions per node type
+
+	Value& lookup(const string& name) {
+		/**
+		 * @brief Finds a variable, in the running function call first and then among the globals.
+		 * @note Like the `variables` map always did, an unknown name is created (holding 0) as a global.
+		 */
+		if (locals) {
+			auto it = locals->find(name);
+			if (it != locals->end()) return it->second;
+		}
+		return variables[name];
+	}
+
+	Value& declare(const string& name) {
+		/**
+		 * @brief Creates (or resets) a variable in the innermost scope: the running function call, or the globals.
+		 */
+		return locals ? (*locals)[name] : variables[name];
+	}
+};
@@ -2,11 +2,11 @@ import os
 import subprocess
 import time
 
-# Path to the executable
-EXECUTABLE = r"C:\Users\rares\L0_main\L1_work\L2_cpp\ROScript\ROScript\interpreter\bin\ros.exe"  # Or "ros.exe" on Windows
-
 # Top-level folder containing all subfolders with .ros files
-TEST_ROOT_FOLDER = r"C:\Users\rares\L0_main\L1_work\L2_cpp\ROScript\ROScript\unit_tests"
+TEST_ROOT_FOLDER = os.path.dirname(os.path.abspath(__file__))
+
+# Path to the executable
+EXECUTABLE = os.path.join(TEST_ROOT_FOLDER, "..", "interpreter", "bin", "ros.exe" if os.name == "nt" else "ros")
 
 def find_ros_files(folder):
     ros_files = []